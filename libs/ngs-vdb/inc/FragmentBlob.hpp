@@ -53,6 +53,20 @@ namespace ncbi
                 void GetFragmentInfo ( uint64_t offset, std::string * fragId, uint64_t * startInBlob, uint64_t * lengthInBases, bool * biological ) const
                     throw ( :: ngs :: ErrorMsg );
 
+                /* GetFragmentRow
+                 *  same as GetFragmentInfo without building the fragment id string
+                 *  fragNum is negative for technical fragments, all outputs are required
+                 */
+                void GetFragmentRow ( uint64_t offset, int64_t * rowId, uint64_t * startInBlob, uint64_t * lengthInBases, int32_t * fragNum ) const
+                    throw ( :: ngs :: ErrorMsg );
+
+                /* GetFragmentId
+                 *  the fragId GetFragmentInfo reports for a biological fragment, from the rowId and fragNum of GetFragmentRow
+                 *  only formats the id, does not access the blob's cursor
+                 */
+                void GetFragmentId ( int64_t rowId, int32_t fragNum, std::string * fragId ) const
+                    throw ( :: ngs :: ErrorMsg );
+
             public:
 
                 // C++ support
@@ -111,10 +111,7 @@ FragmentBlob :: GetFragmentInfo ( uint64_t p_offset, string * p_fragId, uint64_t
     THROW_ON_FAIL ( NGS_FragmentBlobInfoByOffset ( self, ctx, p_offset, & rowId, & startInBlob, & lengthInBases, & fragNum ) );
     if ( fragNum >= 0 )
     {
-        THROW_ON_FAIL ( const NGS_String * run = NGS_FragmentBlobRun ( self, ctx ) );
-        THROW_ON_FAIL ( const NGS_String* readId = NGS_IdMakeFragment ( ctx, run, false, rowId, fragNum ) );
-        THROW_ON_FAIL ( fragId = string ( NGS_StringData ( readId, ctx ), NGS_StringSize ( readId, ctx ) ) );
-        THROW_ON_FAIL ( NGS_StringRelease ( readId, ctx ) );
+        GetFragmentId ( rowId, fragNum, & fragId );
         biological = true;
     }
     else
@@ -141,6 +138,25 @@ FragmentBlob :: GetFragmentInfo ( uint64_t p_offset, string * p_fragId, uint64_t
     }
 }
 
+void
+FragmentBlob :: GetFragmentRow ( uint64_t p_offset, int64_t * p_rowId, uint64_t * p_startInBlob, uint64_t * p_lengthInBases, int32_t * p_fragNum ) const
+    throw ( :: ngs :: ErrorMsg )
+{
+    HYBRID_FUNC_ENTRY ( rcSRA, rcArc, rcAccessing );
+    THROW_ON_FAIL ( NGS_FragmentBlobInfoByOffset ( self, ctx, p_offset, p_rowId, p_startInBlob, p_lengthInBases, p_fragNum ) );
+}
+
+void
+FragmentBlob :: GetFragmentId ( int64_t p_rowId, int32_t p_fragNum, string * p_fragId ) const
+    throw ( :: ngs :: ErrorMsg )
+{
+    HYBRID_FUNC_ENTRY ( rcSRA, rcArc, rcAccessing );
+    THROW_ON_FAIL ( const NGS_String * run = NGS_FragmentBlobRun ( self, ctx ) );
+    THROW_ON_FAIL ( const NGS_String* readId = NGS_IdMakeFragment ( ctx, run, false, p_rowId, p_fragNum ) );
+    THROW_ON_FAIL ( * p_fragId = string ( NGS_StringData ( readId, ctx ), NGS_StringSize ( readId, ctx ) ) );
+    THROW_ON_FAIL ( NGS_StringRelease ( readId, ctx ) );
+}
+
 void
 FragmentBlob :: GetRowRange ( int64_t * first, uint64_t * count ) const throw ( :: ngs :: ErrorMsg )
 {
@@ -242,6 +242,48 @@ FIXTURE_TEST_CASE ( FragmentBlob_GetFragmentInfo_Biological, FragmentBlobFixture
     EXIT;
 }
 
+FIXTURE_TEST_CASE ( FragmentBlob_GetFragmentRow, FragmentBlobFixture )
+{
+    ENTRY;
+    MakeIterator ( ctx, SRA_Accession );
+
+    TRY ( NGS_FragmentBlob* ref = NGS_FragmentBlobIteratorNext ( m_iter, ctx ) )
+    {
+        FragmentBlob b ( ref );
+        int64_t rowId = 0;
+        uint64_t startInBlob = 0;
+        uint64_t lengthInBases = 0;
+        int32_t fragNum = -1;
+        b . GetFragmentRow ( 300, & rowId, & startInBlob, & lengthInBases, & fragNum );
+        REQUIRE_EQ ( (int64_t)2, rowId );
+        REQUIRE_EQ ( (int32_t)0, fragNum );
+        REQUIRE_EQ ( (uint64_t)288, startInBlob );
+        REQUIRE_EQ ( (uint64_t)115, lengthInBases );
+
+        NGS_FragmentBlobRelease ( ref, ctx );
+    }
+
+    EXIT;
+}
+
+FIXTURE_TEST_CASE ( FragmentBlob_GetFragmentId, FragmentBlobFixture )
+{
+    ENTRY;
+    MakeIterator ( ctx, SRA_Accession );
+
+    TRY ( NGS_FragmentBlob* ref = NGS_FragmentBlobIteratorNext ( m_iter, ctx ) )
+    {
+        FragmentBlob b ( ref );
+        std::string fragId;
+        b . GetFragmentId ( 2, 0, & fragId );
+        REQUIRE_EQ ( SRA_Accession+".FR0.2", fragId );
+
+        NGS_FragmentBlobRelease ( ref, ctx );
+    }
+
+    EXIT;
+}
+
 FIXTURE_TEST_CASE ( FragmentBlob_GetRowRange, FragmentBlobFixture )
 {
     ENTRY;
@@ -27,6 +27,7 @@
 #include "blobmatchiterator.hpp"
 
 #include <sstream>
+#include <algorithm>
 
 #include <kproc/lock.h>
 
@@ -50,7 +51,9 @@ public:
     :   SearchBuffer ( p_sb, p_accession ),
         m_dbLock ( p_lock ),
         m_blob ( p_blob ),
-        m_startInBlob ( 0 )
+        m_startInBlob ( 0 ),
+        m_hits ( 0 ),
+        m_tableAfterHits ( TableAfterHits ( p_blob ) )
     {
         KLockAddRef ( m_dbLock );
     }
@@ -72,32 +75,19 @@ public:
             hitStart += m_startInBlob;
             hitEnd += m_startInBlob;
 
-            string fragId;
-            uint64_t startInBlob;
-            uint64_t lengthInBases;
-            bool biological;
-
-            KLockAcquire ( m_dbLock ); //TODO: consider removing
-            try
-            {
-                m_blob . GetFragmentInfo ( hitStart, & fragId, & startInBlob, & lengthInBases, & biological );
-            }
-            catch ( ... )
-            {
-                KLockUnlock ( m_dbLock );
-                throw;
-            }
-            KLockUnlock ( m_dbLock ); //TODO: consider removing
+            const Fragment frag = LocateFragment ( hitStart );
+            const uint64_t startInBlob = frag . m_start;
+            const uint64_t lengthInBases = frag . m_length;
 
             uint64_t fragEnd = startInBlob + lengthInBases; // relative to the start of the blob
 
-            if ( biological )
+            if ( frag . m_fragNum >= 0 ) // biological
             {
                 if ( hitEnd < fragEnd ||                                                                  // inside a fragment: report and move to the next fragment; or
                     m_searchBlock -> FirstMatch ( m_blob . Data () + startInBlob, lengthInBases  ) )    // result crosses fragment boundary: retry within the fragment
                 {
                     Match * ret = 0;
-                    ret = new Match ( m_accession, fragId, string ( m_blob . Data () + startInBlob, lengthInBases ) );
+                    ret = new Match ( m_accession, FragmentId ( frag ), string ( m_blob . Data () + startInBlob, lengthInBases ), m_searchBlock -> MatchedQuery () );
                     m_startInBlob = fragEnd; // search will resume with the next fragment
                     return ret;
                 }
@@ -120,11 +110,103 @@ public:
     }
 
 private:
-    KLock*          m_dbLock;
-    FragmentBlob    m_blob;
-    uint64_t        m_startInBlob;
+    struct Fragment
+    {
+        uint64_t    m_start;    // in the blob
+        uint64_t    m_length;
+        int64_t     m_rowId;
+        int32_t     m_fragNum;  // negative for technical fragments
+    };
+
+    // the blob's fragment table costs a cursor call per fragment, so it is only built once hits have been found in
+    // a quarter as many fragments as the blob has rows (at least MinTableAfterHits); the hits before that are looked up
+    // one at a time. Both take m_dbLock, the table lookups do not
+    static const uint64_t MinTableAfterHits = 16;
+
+    static uint64_t TableAfterHits ( const FragmentBlob & p_blob )
+    {
+        int64_t first;
+        uint64_t count;
+        p_blob . GetRowRange ( & first, & count );
+        return max ( MinTableAfterHits, count / 4 );
+    }
+
+    Fragment LocateFragment ( uint64_t p_offset )
+    {
+        if ( ! m_fragments . empty () )
+        {
+            return FindFragment ( p_offset );
+        }
+
+        Fragment ret;
+        KLockAcquire ( m_dbLock );
+        try
+        {
+            if ( m_hits < m_tableAfterHits )
+            {
+                ++ m_hits;
+                m_blob . GetFragmentRow ( p_offset, & ret . m_rowId, & ret . m_start, & ret . m_length, & ret . m_fragNum );
+            }
+            else
+            {
+                LoadFragments ();
+            }
+        }
+        catch ( ... )
+        {
+            KLockUnlock ( m_dbLock );
+            throw;
+        }
+        KLockUnlock ( m_dbLock );
+
+        return m_fragments . empty () ? ret : FindFragment ( p_offset );
+    }
+
+    // under m_dbLock
+    void LoadFragments ()
+    {
+        uint64_t offset = 0;
+        while ( offset < m_blob . Size () )
+        {
+            Fragment frag;
+            m_blob . GetFragmentRow ( offset, & frag . m_rowId, & frag . m_start, & frag . m_length, & frag . m_fragNum );
+            m_fragments . push_back ( frag );
+            offset = max ( offset + 1, frag . m_start + frag . m_length );
+        }
+    }
+
+    static bool StartsBefore ( uint64_t p_offset, const Fragment & p_frag )
+    {
+        return p_offset < p_frag . m_start;
+    }
+
+    const Fragment & FindFragment ( uint64_t p_offset ) const
+    {   // the last fragment starting at or before p_offset
+        vector < Fragment > :: const_iterator it = upper_bound ( m_fragments . begin (), m_fragments . end (), p_offset, StartsBefore );
+        if ( it == m_fragments . begin () )
+        {
+            throw ( ErrorMsg ( "BlobSearchBuffer: no fragment at the offset" ) );
+        }
+        return * ( it - 1 );
+    }
+
+    string FragmentId ( const Fragment & p_frag ) const
+    {   // only formats the Id, no need for m_dbLock
+        string ret;
+        m_blob . GetFragmentId ( p_frag . m_rowId, p_frag . m_fragNum, & ret );
+        return ret;
+    }
+
+    KLock*                  m_dbLock;
+    FragmentBlob            m_blob;
+    uint64_t                m_startInBlob;
+    uint64_t                m_hits;         // looked up one at a time
+    uint64_t                m_tableAfterHits;
+    vector < Fragment >     m_fragments;    // ordered by m_start
 };
 
+const uint64_t BlobSearchBuffer :: MinTableAfterHits;
+
 ////////////////////////////////// BlobMatchIterator
 
 // bound to a single blob
@@ -166,12 +248,18 @@ private:
 
 ////////////////////////////////// BlobSearch
 
-BlobSearch :: BlobSearch ( const SearchBlock :: Factory & p_factory, const std :: string & p_accession )
+BlobSearch :: BlobSearch ( const SearchBlock :: Factory &  p_factory,
+                          const std :: string &           p_accession,
+                          const KmerIndex *               p_index,
+                          const KmerIndex :: Seeds *      p_seeds )
 :   m_factory ( p_factory ),
     m_accession ( p_accession ),
     m_coll ( NGS_VDB :: openVdbReadCollection ( p_accession ) ),
-    m_blobIt ( m_coll . getFragmentBlobs() )
+    m_blobIt ( m_coll . getFragmentBlobs() ),
+    m_index ( p_index ),
+    m_seeds ( p_seeds )
 {
+    assert ( ( m_index == 0 ) == ( m_seeds == 0 ) );
     rc_t rc = KLockMake ( & m_accessionLock );
     if ( rc != 0 )
     {
@@ -189,9 +277,28 @@ BlobSearch :: NextIterator ()
 {   // return single blob iterators
     MatchIterator * ret = 0;
     KLockAcquire ( m_accessionLock );
-    if ( m_blobIt . hasMore () )
+    try
+    {
+        while ( ret == 0 && m_blobIt . hasMore () )
+        {
+            FragmentBlob blob = m_blobIt . nextBlob ();
+            if ( m_index != 0 )
+            {
+                int64_t first;
+                uint64_t count;
+                blob . GetRowRange ( & first, & count );
+                if ( ! m_index -> MayContain ( first, * m_seeds ) )
+                {
+                    continue;
+                }
+            }
+            ret = new BlobMatchIterator ( m_factory, m_accession, m_accessionLock, blob );
+        }
+    }
+    catch ( ... )
     {
-        ret = new BlobMatchIterator ( m_factory, m_accession, m_accessionLock, m_blobIt . nextBlob () );
+        KLockUnlock ( m_accessionLock );
+        throw;
     }
     KLockUnlock ( m_accessionLock );
     return ret;
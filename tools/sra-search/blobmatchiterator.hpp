@@ -32,15 +32,20 @@
 #include "threadablesearch.hpp"
 #include "searchblock.hpp"
 #include "matchiterator.hpp"
+#include "kmerindex.hpp"
 
 struct KLock;
 
 // Searches blob by blob
 // each iterator returned by NextIterator() is bound to a single blob, to support thread-per-blob multithreading
+// with a KmerIndex, the blobs that cannot contain the seeds are skipped
 class BlobSearch : public ThreadableSearch
 {
 public:
-    BlobSearch ( const SearchBlock :: Factory & p_factory, const std :: string & p_accession );
+    BlobSearch ( const SearchBlock :: Factory &  p_factory,
+                 const std :: string &           p_accession,
+                 const KmerIndex *               p_index = 0,
+                 const KmerIndex :: Seeds *      p_seeds = 0 );
     virtual ~ BlobSearch ();
 
     virtual MatchIterator * NextIterator ();
@@ -51,6 +56,8 @@ private:
     ncbi::ngs::vdb::VdbReadCollection       m_coll;
     struct KLock*                           m_accessionLock;
     ncbi::ngs::vdb::FragmentBlobIterator    m_blobIt;
+    const KmerIndex *                       m_index; // not owned
+    const KmerIndex :: Seeds *              m_seeds; // not owned
 };
 
 #endif
@@ -28,11 +28,98 @@
 
 #include <ngs/ncbi/NGS.hpp>
 
+#include <algorithm>
+
 #include "searchbuffer.hpp"
 
 using namespace std;
 using namespace ngs;
 
+///////////////////// FragmentBatch
+
+// reads fragments ahead to search them with a SearchBlock::FirstMatches() call per batch
+class FragmentBatch
+{
+public:
+    FragmentBatch ( SearchBlock & p_sb, ReadIterator & p_readIt, bool p_unalignedOnly )
+    :   m_sb ( p_sb ),
+        m_readIt ( p_readIt ),
+        m_unalignedOnly ( p_unalignedOnly ),
+        m_readsDone ( false ),
+        m_nextMatched ( 0 )
+    {
+    }
+
+    SearchBuffer :: Match * NextMatch ( const string & p_accession )
+    {
+        while ( m_nextMatched == m_matched . size () )
+        {
+            if ( ! Fill () )
+            {
+                return 0;
+            }
+        }
+        const size_t i = m_matched [ m_nextMatched ++ ];
+        const size_t start = i == 0 ? 0 : m_ends [ i - 1 ];
+        // the search blocks that batch have a single query
+        return new SearchBuffer :: Match ( p_accession, m_ids [ i ], m_bases . substr ( start, m_ends [ i ] - start ) );
+    }
+
+private:
+    // reads and searches the next batch; false if there are no fragments left
+    bool Fill ()
+    {
+        m_bases . clear ();
+        m_ends . clear ();
+        m_ids . clear ();
+        m_matched . clear ();
+        m_nextMatched = 0;
+
+        const size_t batchSize = m_sb . BatchSize ();
+        while ( m_ids . size () < batchSize && ! m_readsDone )
+        {
+            if ( ! m_readIt . nextFragment () )
+            {
+                m_readsDone = ! m_readIt . nextRead ();
+            }
+            else if ( ! m_unalignedOnly || ! m_readIt . isAligned () )
+            {
+                const StringRef bases = m_readIt . getFragmentBases ();
+                m_bases . append ( bases . data (), bases . size () );
+                m_ends . push_back ( m_bases . size () );
+                m_ids . push_back ( m_readIt . getFragmentId () . toString () );
+            }
+        }
+        if ( m_ids . empty () )
+        {
+            return false;
+        }
+
+        m_fragments . resize ( m_ids . size () );
+        m_sizes . resize ( m_ids . size () );
+        for ( size_t i = 0, start = 0; i < m_ids . size (); start = m_ends [ i ], ++i )
+        {
+            m_fragments [ i ] = m_bases . data () + start;
+            m_sizes [ i ] = m_ends [ i ] - start;
+        }
+        m_sb . FirstMatches ( & m_fragments [ 0 ], & m_sizes [ 0 ], m_ids . size (), m_matched );
+        return true;
+    }
+
+    SearchBlock &   m_sb;
+    ReadIterator &  m_readIt;
+    bool            m_unalignedOnly;
+    bool            m_readsDone;
+
+    string                  m_bases;        // of all fragments in the batch
+    vector < size_t >       m_ends;         // of every fragment's bases in m_bases
+    vector < string >       m_ids;
+    vector < const char * > m_fragments;
+    vector < size_t >       m_sizes;
+    vector < size_t >       m_matched;      // indexes of the fragments with a match
+    size_t                  m_nextMatched;
+};
+
 ///////////////////// FragmentMatchIterator
 
 class FragmentMatchIterator : public MatchIterator
@@ -41,18 +128,33 @@ public:
     FragmentMatchIterator ( SearchBlock :: Factory & p_factory, ngs::ReadCollection p_run, bool p_unalignedOnly = false )
     :   MatchIterator ( p_factory, p_run . getName () ),
         m_readIt ( p_run . getReads ( Read :: all ) ),
-        m_sb ( p_factory . MakeSearchBlock () )
+        m_sb ( p_factory . MakeSearchBlock () ),
+        m_batch ( m_sb -> BatchSize () > 1 ? new FragmentBatch ( * m_sb, m_readIt, false ) : 0 )
+    {
+        m_readIt . nextRead ();
+    }
+
+    FragmentMatchIterator ( SearchBlock :: Factory & p_factory, ngs::ReadCollection p_run, int64_t p_firstRow, uint64_t p_rowCount )
+    :   MatchIterator ( p_factory, p_run . getName () ),
+        m_readIt ( p_run . getReadRange ( p_firstRow, p_rowCount, Read :: all ) ),
+        m_sb ( p_factory . MakeSearchBlock () ),
+        m_batch ( m_sb -> BatchSize () > 1 ? new FragmentBatch ( * m_sb, m_readIt, false ) : 0 )
     {
         m_readIt . nextRead ();
     }
 
     ~ FragmentMatchIterator()
     {
+        delete m_batch;
         delete m_sb;
     }
 
     virtual SearchBuffer :: Match * NextMatch ()
     {
+        if ( m_batch != 0 )
+        {
+            return m_batch -> NextMatch ( m_accession );
+        }
         do
         {
             while ( m_readIt . nextFragment () )
@@ -61,7 +163,7 @@ public:
                 StringRef bases = m_readIt . getFragmentBases ();
                 if ( m_sb -> FirstMatch ( bases . data (), bases . size () ) )
                 {
-                    return new SearchBuffer :: Match ( m_accession, m_readIt . getFragmentId () . toString (), bases . toString () );
+                    return new SearchBuffer :: Match ( m_accession, m_readIt . getFragmentId () . toString (), bases . toString (), m_sb -> MatchedQuery () );
                 }
             }
         }
@@ -72,6 +174,7 @@ public:
 private:
     ngs::ReadIterator   m_readIt;
     SearchBlock *       m_sb;
+    FragmentBatch *     m_batch;    // 0 unless the search block does better on several fragments at once
 };
 
 ///////////////////// UnalignedFragmentMatchIterator
@@ -79,19 +182,34 @@ private:
 UnalignedFragmentMatchIterator :: UnalignedFragmentMatchIterator ( SearchBlock :: Factory & p_factory, const ngs::ReadCollection & m_run )
 :   MatchIterator ( p_factory, m_run . getName () ),
     m_readIt ( m_run . getReads ( ( ngs :: Read :: ReadCategory ) ( ngs :: Read :: unaligned | ngs :: Read :: partiallyAligned ) ) ),
-    m_sb ( p_factory . MakeSearchBlock () )
+    m_sb ( p_factory . MakeSearchBlock () ),
+    m_batch ( m_sb -> BatchSize () > 1 ? new FragmentBatch ( * m_sb, m_readIt, true ) : 0 )
+{
+    m_readIt . nextRead ();
+}
+
+UnalignedFragmentMatchIterator :: UnalignedFragmentMatchIterator ( SearchBlock :: Factory & p_factory, const ngs::ReadCollection & m_run, int64_t p_firstRow, uint64_t p_rowCount )
+:   MatchIterator ( p_factory, m_run . getName () ),
+    m_readIt ( m_run . getReadRange ( p_firstRow, p_rowCount, ( ngs :: Read :: ReadCategory ) ( ngs :: Read :: unaligned | ngs :: Read :: partiallyAligned ) ) ),
+    m_sb ( p_factory . MakeSearchBlock () ),
+    m_batch ( m_sb -> BatchSize () > 1 ? new FragmentBatch ( * m_sb, m_readIt, true ) : 0 )
 {
     m_readIt . nextRead ();
 }
 
 UnalignedFragmentMatchIterator :: ~ UnalignedFragmentMatchIterator()
 {
+    delete m_batch;
     delete m_sb;
 }
 
 SearchBuffer :: Match *
 UnalignedFragmentMatchIterator :: NextMatch ()
 {
+    if ( m_batch != 0 )
+    {
+        return m_batch -> NextMatch ( m_accession );
+    }
     do
     {
         while ( m_readIt . nextFragment () )
@@ -102,7 +220,7 @@ UnalignedFragmentMatchIterator :: NextMatch ()
                 StringRef bases = m_readIt . getFragmentBases ();
                 if ( m_sb -> FirstMatch ( bases . data (), bases . size () ) )
                 {
-                    return new SearchBuffer :: Match ( m_accession, m_readIt . getFragmentId () . toString (), bases . toString () );
+                    return new SearchBuffer :: Match ( m_accession, m_readIt . getFragmentId () . toString (), bases . toString (), m_sb -> MatchedQuery () );
                 }
             }
         }
@@ -113,18 +231,32 @@ UnalignedFragmentMatchIterator :: NextMatch ()
 
 ///////////////////// FragmentSearch
 
-FragmentSearch :: FragmentSearch ( SearchBlock :: Factory & p_factory, const std::string & p_accession, bool p_unalignedOnly )
-: m_iter ( 0 )
-{
-    ngs::ReadCollection coll ( ncbi :: NGS :: openReadCollection ( p_accession ) );
+const uint64_t FragmentSearch :: UnalignedRowsPerIterator;
 
-    if ( p_unalignedOnly )
+FragmentSearch :: FragmentSearch ( SearchBlock :: Factory & p_factory, const std::string & p_accession, bool p_unalignedOnly, const KmerIndex :: RowRanges * p_rows )
+:   m_factory ( p_factory ),
+    m_accession ( p_accession ),
+    m_run ( ncbi :: NGS :: openReadCollection ( p_accession ) ),
+    m_unalignedOnly ( p_unalignedOnly ),
+    m_allRows ( p_rows == 0 && ! p_unalignedOnly ),
+    m_nextRange ( 0 ),
+    m_iter ( 0 )
+{
+    if ( p_rows != 0 )
     {
-        m_iter = new UnalignedFragmentMatchIterator ( p_factory, coll );
+        m_rows = * p_rows;
+    }
+    else if ( p_unalignedOnly )
+    {   // rows are numbered from 1
+        const uint64_t rowCount = m_run . getReadCount ( Read :: all );
+        for ( uint64_t first = 1; first <= rowCount; first += UnalignedRowsPerIterator )
+        {
+            m_rows . push_back ( KmerIndex :: RowRanges :: value_type ( ( int64_t ) first, min ( UnalignedRowsPerIterator, rowCount - first + 1 ) ) );
+        }
     }
     else
     {
-        m_iter = new FragmentMatchIterator ( p_factory, coll );
+        m_iter = new FragmentMatchIterator ( p_factory, m_run );
     }
 }
 
@@ -135,7 +267,22 @@ FragmentSearch :: ~ FragmentSearch ()
 
 MatchIterator *
 FragmentSearch :: NextIterator ()
-{   // fragments can only be processed sequentially, so there is just 1 iterator to return
+{   // fragments can only be processed sequentially, so there is just 1 iterator to return, or 1 per row range
+    if ( ! m_allRows )
+    {
+        if ( m_nextRange == m_rows . size () )
+        {
+            return 0;
+        }
+        const KmerIndex :: RowRanges :: value_type & range = m_rows [ m_nextRange ++ ];
+        // the ranges are searched by different threads, each through a collection of its own, as separate accessions are
+        const ReadCollection run = ncbi :: NGS :: openReadCollection ( m_accession );
+        if ( m_unalignedOnly )
+        {
+            return new UnalignedFragmentMatchIterator ( m_factory, run, range . first, range . second );
+        }
+        return new FragmentMatchIterator ( m_factory, run, range . first, range . second );
+    }
     if ( m_iter != 0  )
     {
         MatchIterator * ret = m_iter;
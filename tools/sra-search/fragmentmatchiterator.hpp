@@ -30,28 +30,42 @@
 #include <ngs/ReadCollection.hpp>
 #include "threadablesearch.hpp"
 #include "matchiterator.hpp"
+#include "kmerindex.hpp"
 
 class SearchBuffer;
+class FragmentBatch;
 
 // Searches fragment by fragment
-// returns 1 iterator for the entire SEQUENCE table
+// returns 1 iterator for the entire SEQUENCE table, or 1 iterator per row range if the ranges are given (see KmerIndex)
+// unaligned-only searches are split into ranges of UnalignedRowsPerIterator rows, which can be searched in parallel;
+// every row range is read through its own ReadCollection, ReadIterators of one collection are not used across threads
 class FragmentSearch : public ThreadableSearch
 {
 public:
-    FragmentSearch ( SearchBlock :: Factory & p_factory, const std::string & p_accession, bool p_unalignedOnly = false );
+    static const uint64_t UnalignedRowsPerIterator = 250000;
+
+    FragmentSearch ( SearchBlock :: Factory & p_factory, const std::string & p_accession, bool p_unalignedOnly = false, const KmerIndex :: RowRanges * p_rows = 0 );
 
     virtual ~ FragmentSearch ();
 
     virtual MatchIterator * NextIterator ();
 
 private:
-    MatchIterator * m_iter;
+    SearchBlock :: Factory &    m_factory;
+    std::string                 m_accession;
+    ngs::ReadCollection         m_run;
+    bool                        m_unalignedOnly;
+    KmerIndex :: RowRanges      m_rows;
+    bool                        m_allRows;
+    size_t                      m_nextRange;
+    MatchIterator *             m_iter;
 };
 
 class UnalignedFragmentMatchIterator : public MatchIterator
 {
 public:
     UnalignedFragmentMatchIterator ( SearchBlock :: Factory & p_factory, const ngs::ReadCollection & p_run );
+    UnalignedFragmentMatchIterator ( SearchBlock :: Factory & p_factory, const ngs::ReadCollection & p_run, int64_t p_firstRow, uint64_t p_rowCount );
     virtual ~UnalignedFragmentMatchIterator ();
 
     virtual SearchBuffer :: Match * NextMatch ();
@@ -59,6 +73,7 @@ public:
 private:
     ngs::ReadIterator   m_readIt;
     SearchBlock *       m_sb;
+    FragmentBatch *     m_batch;    // 0 unless the search block does better on several fragments at once
 };
 
 
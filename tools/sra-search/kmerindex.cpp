@@ -0,0 +1,366 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "kmerindex.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cassert>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <ngs/ErrorMsg.hpp>
+
+#include <ngs-vdb/inc/NGS-VDB.hpp>
+
+using namespace std;
+using namespace ngs;
+using namespace ncbi::ngs::vdb;
+
+static const char Magic [ 8 ] = { 'S', 'R', 'A', 'S', 'K', 'I', 'X', '1' };
+
+static
+int
+BaseCode ( char p_base )
+{
+    switch ( p_base )
+    {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default:            return -1;
+    }
+}
+
+static const uint32_t WordMask = ( 1u << ( 2 * KmerIndex :: WordLength ) ) - 1;
+
+//////////////////// KmerIndex :: Seeds
+
+KmerIndex :: Seeds :: Seeds ( const vector < string > & p_queries, unsigned int p_minScorePct )
+:   m_selective ( true )
+{
+    for ( vector < string > :: const_iterator i = p_queries . begin (); i != p_queries . end () && m_selective; ++i )
+    {
+        AddQuery ( *i, i -> size () * ( 100 - p_minScorePct ) / 100 );
+    }
+}
+
+void
+KmerIndex :: Seeds :: AddQuery ( const string & p_query, unsigned int p_errors )
+{
+    const size_t pieceCount = p_errors + 1;
+    const size_t pieceLength = p_query . size () / pieceCount;
+    if ( pieceLength < WordLength )
+    {
+        m_selective = false;
+        return;
+    }
+
+    for ( size_t p = 0; p < pieceCount; ++p )
+    {
+        const size_t start = p * pieceLength;
+        const size_t end = p + 1 == pieceCount ? p_query . size () : start + pieceLength;
+
+        // words made of ACGT only; anything else (N, IUPAC) is not indexed
+        Piece piece;
+        uint32_t word = 0;
+        unsigned int valid = 0;
+        for ( size_t i = start; i < end; ++i )
+        {
+            const int code = BaseCode ( p_query [ i ] );
+            if ( code < 0 )
+            {
+                valid = 0;
+                continue;
+            }
+            word = ( ( word << 2 ) | code ) & WordMask;
+            if ( ++ valid >= WordLength )
+            {
+                piece . push_back ( word );
+            }
+        }
+        if ( piece . empty () )
+        {
+            m_selective = false;
+            return;
+        }
+        m_pieces . push_back ( piece );
+    }
+}
+
+//////////////////// KmerIndex
+
+KmerIndex :: KmerIndex ()
+{
+}
+
+uint64_t
+KmerIndex :: BitOf ( uint32_t p_word, uint32_t p_bitsLog2 )
+{   // Fibonacci hashing, the top bits spread all words
+    return ( p_word * 0x9E3779B97F4A7C15ull ) >> ( 64 - p_bitsLog2 );
+}
+
+void
+KmerIndex :: AddBlob ( int64_t p_firstRow, uint64_t p_rowCount, const char * p_bases, size_t p_size )
+{
+    assert ( m_blobs . empty () || m_blobs . back () . m_firstRow < p_firstRow );
+
+    m_blobs . push_back ( Blob () );
+    Blob & blob = m_blobs . back ();
+    blob . m_firstRow = p_firstRow;
+    blob . m_rowCount = p_rowCount;
+    blob . m_bitsLog2 = 10;
+    while ( blob . m_bitsLog2 < 31 && ( ( uint64_t ) 1 << blob . m_bitsLog2 ) < ( uint64_t ) p_size * BitsPerBase )
+    {
+        ++ blob . m_bitsLog2;
+    }
+    blob . m_bits . resize ( ( ( uint64_t ) 1 << blob . m_bitsLog2 ) / 64, 0 );
+
+    // words running across fragment boundaries are indexed too; they only make the index less selective
+    uint32_t word = 0;
+    unsigned int valid = 0;
+    for ( size_t i = 0; i < p_size; ++i )
+    {
+        const int code = BaseCode ( p_bases [ i ] );
+        if ( code < 0 )
+        {
+            valid = 0;
+            continue;
+        }
+        word = ( ( word << 2 ) | code ) & WordMask;
+        if ( ++ valid >= WordLength )
+        {
+            const uint64_t bit = BitOf ( word, blob . m_bitsLog2 );
+            blob . m_bits [ bit / 64 ] |= ( uint64_t ) 1 << ( bit % 64 );
+        }
+    }
+}
+
+void
+KmerIndex :: Build ( const string & p_accession )
+{
+    m_accession = p_accession;
+    m_blobs . clear ();
+
+    VdbReadCollection coll = NGS_VDB :: openVdbReadCollection ( p_accession );
+    FragmentBlobIterator blobIt = coll . getFragmentBlobs ();
+    while ( blobIt . hasMore () )
+    {
+        FragmentBlob blob = blobIt . nextBlob ();
+        int64_t first;
+        uint64_t count;
+        blob . GetRowRange ( & first, & count );
+        AddBlob ( first, count, blob . Data (), blob . Size () );
+    }
+}
+
+bool
+KmerIndex :: Contains ( const Blob & p_blob, const Seeds & p_seeds )
+{
+    for ( vector < Seeds :: Piece > :: const_iterator p = p_seeds . m_pieces . begin (); p != p_seeds . m_pieces . end (); ++p )
+    {
+        Seeds :: Piece :: const_iterator w = p -> begin ();
+        for ( ; w != p -> end (); ++w )
+        {
+            const uint64_t bit = BitOf ( *w, p_blob . m_bitsLog2 );
+            if ( ( p_blob . m_bits [ bit / 64 ] & ( ( uint64_t ) 1 << ( bit % 64 ) ) ) == 0 )
+            {
+                break;
+            }
+        }
+        if ( w == p -> end () )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+KmerIndex :: MayContain ( int64_t p_firstRow, const Seeds & p_seeds ) const
+{
+    if ( ! p_seeds . IsSelective () )
+    {
+        return true;
+    }
+
+    size_t lo = 0;
+    size_t hi = m_blobs . size ();
+    while ( lo < hi )
+    {
+        const size_t mid = lo + ( hi - lo ) / 2;
+        if ( m_blobs [ mid ] . m_firstRow < p_firstRow )
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if ( lo == m_blobs . size () || m_blobs [ lo ] . m_firstRow != p_firstRow )
+    {   // not indexed
+        return true;
+    }
+    return Contains ( m_blobs [ lo ], p_seeds );
+}
+
+void
+KmerIndex :: CandidateRows ( const Seeds & p_seeds, RowRanges & p_ranges ) const
+{
+    p_ranges . clear ();
+    for ( vector < Blob > :: const_iterator i = m_blobs . begin (); i != m_blobs . end (); ++i )
+    {
+        if ( p_seeds . IsSelective () && ! Contains ( *i, p_seeds ) )
+        {
+            continue;
+        }
+        if ( ! p_ranges . empty () && p_ranges . back () . first + ( int64_t ) p_ranges . back () . second == i -> m_firstRow )
+        {
+            p_ranges . back () . second += i -> m_rowCount;
+        }
+        else
+        {
+            p_ranges . push_back ( RowRanges :: value_type ( i -> m_firstRow, i -> m_rowCount ) );
+        }
+    }
+}
+
+void
+KmerIndex :: Save ( const string & p_filename ) const
+{   // written under a temporary name unique to the process, so that a concurrent search never sees a partial file
+    // and two searches building the same index do not write into each other's file
+    ostringstream tmp;
+    tmp << p_filename << "." << getpid () << ".tmp";
+    const string tmpName = tmp . str ();
+    {
+        ofstream out ( tmpName . c_str (), ios :: binary | ios :: trunc );
+
+        const uint32_t header [ 3 ] = { WordLength, BitsPerBase, ( uint32_t ) m_accession . size () };
+        const uint64_t blobCount = m_blobs . size ();
+        out . write ( Magic, sizeof ( Magic ) );
+        out . write ( ( const char * ) header, sizeof ( header ) );
+        out . write ( m_accession . data (), m_accession . size () );
+        out . write ( ( const char * ) & blobCount, sizeof ( blobCount ) );
+        for ( vector < Blob > :: const_iterator i = m_blobs . begin (); i != m_blobs . end () && out . good (); ++i )
+        {
+            out . write ( ( const char * ) & i -> m_firstRow, sizeof ( i -> m_firstRow ) );
+            out . write ( ( const char * ) & i -> m_rowCount, sizeof ( i -> m_rowCount ) );
+            out . write ( ( const char * ) & i -> m_bitsLog2, sizeof ( i -> m_bitsLog2 ) );
+            out . write ( ( const char * ) & i -> m_bits [ 0 ], i -> m_bits . size () * sizeof ( uint64_t ) );
+        }
+        out . close ();
+        if ( out . fail () )
+        {
+            remove ( tmpName . c_str () );
+            throw ( ErrorMsg ( "KmerIndex: cannot write " + tmpName ) );
+        }
+    }
+    if ( rename ( tmpName . c_str (), p_filename . c_str () ) != 0 )
+    {
+        remove ( tmpName . c_str () );
+        throw ( ErrorMsg ( "KmerIndex: cannot write " + p_filename ) );
+    }
+}
+
+bool
+KmerIndex :: Load ( const string & p_filename, const string & p_accession )
+{
+    ifstream in ( p_filename . c_str (), ios :: binary );
+    if ( ! in . is_open () )
+    {
+        return false;
+    }
+
+    char magic [ sizeof ( Magic ) ];
+    uint32_t header [ 3 ];
+    in . read ( magic, sizeof ( magic ) );
+    in . read ( ( char * ) header, sizeof ( header ) );
+    if ( ! in . good () || memcmp ( magic, Magic, sizeof ( Magic ) ) != 0 ||
+         header [ 0 ] != WordLength || header [ 1 ] != BitsPerBase || header [ 2 ] != p_accession . size () )
+    {
+        return false;
+    }
+    string accession ( header [ 2 ], 0 );
+    in . read ( & accession [ 0 ], accession . size () );
+    uint64_t blobCount = 0;
+    in . read ( ( char * ) & blobCount, sizeof ( blobCount ) );
+    if ( ! in . good () || accession != p_accession )
+    {
+        return false;
+    }
+
+    vector < Blob > blobs;
+    for ( uint64_t i = 0; i < blobCount; ++i )
+    {
+        blobs . push_back ( Blob () );
+        Blob & blob = blobs . back ();
+        in . read ( ( char * ) & blob . m_firstRow, sizeof ( blob . m_firstRow ) );
+        in . read ( ( char * ) & blob . m_rowCount, sizeof ( blob . m_rowCount ) );
+        in . read ( ( char * ) & blob . m_bitsLog2, sizeof ( blob . m_bitsLog2 ) );
+        if ( ! in . good () || blob . m_bitsLog2 < 10 || blob . m_bitsLog2 > 31 )
+        {
+            return false;
+        }
+        if ( i > 0 && blobs [ i - 1 ] . m_firstRow >= blob . m_firstRow )
+        {   // MayContain() looks blobs up by binary search
+            return false;
+        }
+        blob . m_bits . resize ( ( ( uint64_t ) 1 << blob . m_bitsLog2 ) / 64 );
+        in . read ( ( char * ) & blob . m_bits [ 0 ], blob . m_bits . size () * sizeof ( uint64_t ) );
+        if ( ! in . good () )
+        {
+            return false;
+        }
+    }
+
+    m_accession = p_accession;
+    m_blobs . swap ( blobs );
+    return true;
+}
+
+string
+KmerIndex :: FileName ( const string & p_dir, const string & p_accession )
+{
+    string name = p_accession;
+    for ( string :: iterator i = name . begin (); i != name . end (); ++i )
+    {
+        if ( ! isalnum ( ( unsigned char ) *i ) && *i != '.' && *i != '_' && *i != '-' )
+        {
+            *i = '_';
+        }
+    }
+    return p_dir + "/" + name + ".kidx";
+}
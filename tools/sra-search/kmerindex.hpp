@@ -0,0 +1,107 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _hpp_kmer_index_
+#define _hpp_kmer_index_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+// A sidecar index of an accession: for every blob, its row range and a bit set of the hashed short words (q-grams) of its bases.
+// A blob missing any word of a query cannot contain the query, so exact and near-exact searches can skip it.
+// Built in one pass over the blobs of the accession and saved to a local file, to be reused by the following searches.
+class KmerIndex
+{
+public:
+    static const unsigned int WordLength = 12;  // bases
+    static const unsigned int BitsPerBase = 2;  // size of a blob's bit set; 1 bit per base would make ~60% of absent words look present
+
+    typedef std :: vector < std :: pair < int64_t, uint64_t > > RowRanges; // first row, row count
+
+    // words a matching blob has to contain: all the words of at least one of the pieces
+    // with up to E errors allowed, a query is cut into E+1 pieces, one of which will match exactly
+    class Seeds
+    {
+    public:
+        // p_minScorePct as in AgrepSearch
+        Seeds ( const std :: vector < std :: string > & p_queries, unsigned int p_minScorePct );
+
+        // false if some query or piece is too short, or not made of ACGT: every blob has to be searched
+        bool IsSelective () const { return m_selective; }
+
+    private:
+        friend class KmerIndex;
+        typedef std :: vector < uint32_t > Piece;
+
+        void AddQuery ( const std :: string & p_query, unsigned int p_errors );
+
+        bool                m_selective;
+        std :: vector < Piece > m_pieces;
+    };
+
+public:
+    KmerIndex ();
+
+    // one pass over the blobs; throws ErrorMsg
+    void Build ( const std :: string & p_accession );
+
+    void Save ( const std :: string & p_filename ) const; // throws ErrorMsg
+    // false if the file does not exist, is damaged or belongs to another accession
+    bool Load ( const std :: string & p_filename, const std :: string & p_accession );
+
+    // blobs have to be added in the order of their rows
+    void AddBlob ( int64_t p_firstRow, uint64_t p_rowCount, const char * p_bases, size_t p_size );
+
+    size_t BlobCount () const { return m_blobs . size (); }
+
+    // true if the blob starting at p_firstRow may contain a match; blobs not in the index may
+    bool MayContain ( int64_t p_firstRow, const Seeds & p_seeds ) const;
+
+    // row ranges of the blobs that may contain a match, adjacent ranges merged
+    void CandidateRows ( const Seeds & p_seeds, RowRanges & p_ranges ) const;
+
+    // p_dir/<accession>.kidx, with the characters of a path replaced
+    static std :: string FileName ( const std :: string & p_dir, const std :: string & p_accession );
+
+private:
+    struct Blob
+    {
+        int64_t                     m_firstRow;
+        uint64_t                    m_rowCount;
+        uint32_t                    m_bitsLog2;
+        std :: vector < uint64_t >  m_bits;
+    };
+
+    static uint64_t BitOf ( uint32_t p_word, uint32_t p_bitsLog2 );
+    static bool Contains ( const Blob & p_blob, const Seeds & p_seeds );
+
+    std :: string           m_accession;
+    std :: vector < Blob >  m_blobs;
+};
+
+#endif
@@ -120,9 +120,9 @@ DoSearch ( const VdbSearch :: Settings& p_settings, bool p_sortOutput  )
     }
     else
     {
+        VdbSearch :: Match m; // reused, see VdbSearch :: FormatMatch
         while ( true )
         {
-            VdbSearch :: Match m;
             if ( ! s . NextMatch ( m ) )
             {
                 break;
@@ -146,6 +146,7 @@ static void handle_help ( const char * appName )
     cout << endl
         << "Usage:" << endl
         << "  " << fileName << " [Options] query accession ..." << endl
+        << "  " << fileName << " [Options] -f <query file> accession ..." << endl
         << endl
         << "Summary:" << endl
         << "  Searches all reads in the accessions and prints Ids of all the fragments that contain a match." << endl
@@ -153,6 +154,7 @@ static void handle_help ( const char * appName )
         << "Example:" << endl
         << "  sra-search ACGT SRR000001 SRR000002" << endl
         << "  sra-search \"CGTA||ACGT\" -e -a NucStrstr SRR000002" << endl
+        << "  sra-search -f primers.fa -a FgrepAho SRR000002" << endl
         << endl
         << "Options:" << endl
         << "  -h|--help                 Output brief explanation of the program." << endl
@@ -171,14 +173,26 @@ static void handle_help ( const char * appName )
     }
     cout << "  -e|--expression <expr>    Query is an expression (currently only supported for NucStrstr)" << endl
          << "  -S|--score <number>       Minimum match score (0..100), default 100 (perfect match);" << endl
-         << "                            supported for all variants of Agrep and SmithWaterman." << endl
+         << "                            supported for all variants of Agrep, SmithWaterman and MyersBitParallel." << endl
          << "  -T|--threads <number>     The number of threads to use; 2 by deafult" << endl
-         << "  --threadperacc            One thread per accession mode (by default, multiple threads per accession)" << endl
+         << "  --threadperacc            Start the threads on different accessions (by default, all start on the first one);" << endl
+         << "                            a thread done with its accession helps with the others. Not supported with --ordered" << endl
          << "  --sort                    Sort output by accession/read/fragment" << endl
+         << "  --ordered                 Output in the order of accessions and their data, the same with any number of threads;" << endl
+         << "                            unlike --sort, matches are output as they are found" << endl
          << "  --reference [refName,...] Scan reference(s) for potential matches; all references if none specified" << endl
          << "  -m|--max <number>         Stop after N matches" << endl
          << "  -U|--unaligned            Search in unaligned and partially aligned reads only" << endl
          << "  --fasta [ <lineWidth> ]   Output in FASTA format with specified line width (default 70 bases)" << endl
+         << "  -f|--query-file <file>    Search for all queries in the file in one pass; FASTA, or one query per line." << endl
+         << "                            Each matching fragment is reported once, followed by the name of the query found in it;" << endl
+         << "                            if several queries match a fragment, only the one that matches leftmost is reported." << endl
+         << "                            Supported for all variants of Fgrep and Agrep." << endl
+         << "  --kmer-index <dir>        Skip the data that cannot contain the query, using a k-mer index of each accession kept in <dir>;" << endl
+         << "                            a missing index is built before the search starts, one accession at a time on a single thread," << endl
+         << "                            and only used for this search if it cannot be saved. An index takes 2 to 4 bits per base" << endl
+         << "                            of the accession, on disk and in memory: it is loaded whole." << endl
+         << "                            Not supported for SmithWaterman, expressions and --reference." << endl
          ;
 
     cout << endl;
@@ -276,6 +290,10 @@ run( int argc, const char *argv [] )
             {
                 sortOutput = true;
             }
+            else if ( arg == "--ordered" )
+            {
+                settings . m_ordered = true;
+            }
             else if ( arg == "--reference" )
             {
                 settings . m_referenceDriven = true;
@@ -327,6 +345,27 @@ run( int argc, const char *argv [] )
                 }
                 settings . m_fasta = true;
             }
+            else if ( arg == "-f" || arg == "--query-file" )
+            {
+                ++i;
+                if ( i >= argc )
+                {
+                    throw invalid_argument ( string ( "Missing argument for " ) + arg );
+                }
+                if ( ! settings . LoadQueries ( argv [ i ] ) )
+                {
+                    throw invalid_argument ( string ( "Cannot read queries from " ) + argv [ i ] );
+                }
+            }
+            else if ( arg == "--kmer-index" )
+            {
+                ++i;
+                if ( i >= argc )
+                {
+                    throw invalid_argument ( string ( "Missing argument for " ) + arg );
+                }
+                settings . m_indexDir = argv [ i ];
+            }
             else if ( arg == "--ngc" )
             {
                 ++i;
@@ -345,7 +384,12 @@ run( int argc, const char *argv [] )
             ++i;
         }
 
-        if ( settings . m_query . empty () || settings . m_accessions . size () == 0 )
+        if ( ! settings . m_queries . empty () && ! settings . m_query . empty () )
+        {   // with a query file, all positional arguments are accessions
+            settings . m_accessions . insert ( settings . m_accessions . begin (), settings . m_query );
+            settings . m_query . clear ();
+        }
+        if ( ( settings . m_query . empty () && settings . m_queries . empty () ) || settings . m_accessions . size () == 0 )
         {
             throw invalid_argument ( "Missing arguments" );
         }
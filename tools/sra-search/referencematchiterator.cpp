@@ -28,6 +28,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <cstdlib>
 
 #include <klib/log.h>
 
@@ -117,6 +118,8 @@ public:
         m_refSearchReverse ( 0 ),
         m_alIt ( 0 ),
         m_fragIt ( 0 ),
+        m_rowId ( 0 ),
+        m_fragNum ( 0 ),
         m_reported ( p_reported ),
         BlobBoundaryOverlap ( m_searchBlock -> GetQuery () . size() * 2 ),
         m_reverse ( false )
@@ -175,8 +178,11 @@ protected:
                     break;
                 }
 
-                m_fragIt = new FragmentIterator ( m_run . getRead ( m_alIt -> getReadId () . toString() ) );   //TODO: there may be a shortcut to get to the fragment's bases
+                const string readId = m_alIt -> getReadId () . toString();
+                m_fragIt = new FragmentIterator ( m_run . getRead ( readId ) );   //TODO: there may be a shortcut to get to the fragment's bases
                 KLockUnlock ( m_dbLock );
+                m_rowId = RowId ( readId );
+                m_fragNum = 0;
             }
 
             if ( m_fragIt != 0 )
@@ -184,20 +190,16 @@ protected:
                 while ( m_fragIt -> nextFragment () ) // foreach fragment
                 {
                     StringRef fragBases = CurrentFragmentBases ();
+                    const uint32_t fragNum = m_fragNum ++;
 
                     // cout << "Searching " << CurrentFragmentId . toString ( << "'" << fragBases . toString () << "'" << endl;
                     if ( m_searchBlock -> FirstMatch ( fragBases . data (), fragBases . size () ) ) // this search is with the original score threshold
                     {
-                        KLockAcquire ( m_dbLock );
-                        string id = CurrentFragmentId () . toString ();
-                        if ( m_reported . find ( id ) == m_reported.end () )
+                        if ( m_reported . Insert ( m_rowId, fragNum ) )
                         {
                             // cout << "Found " << id << endl;
-                            m_reported . insert ( id );
-                            KLockUnlock ( m_dbLock );
                             return true;
                         }
-                        KLockUnlock ( m_dbLock );
                     }
                 }
                 // no (more) matches on this read
@@ -208,6 +210,17 @@ protected:
         return false;
     }
 
+    // a read Id is <run>.R.<rowId>
+    static int64_t RowId ( const string & p_readId )
+    {
+        const size_t dot = p_readId . rfind ( '.' );
+        if ( dot == string :: npos )
+        {
+            throw ( ErrorMsg ( "ReferenceSearch: unexpected read Id " + p_readId ) );
+        }
+        return strtoll ( p_readId . c_str () + dot + 1, 0, 10 );
+    }
+
 protected:
     ReadCollection  m_run;
     Reference       m_reference;
@@ -220,6 +233,8 @@ protected:
 
     AlignmentIterator * m_alIt;
     FragmentIterator *  m_fragIt;
+    int64_t             m_rowId;    // of m_fragIt's read
+    uint32_t            m_fragNum;  // of m_fragIt's next fragment
 
     ReferenceSearch :: ReportedFragments & m_reported; // all fragments reported for the parent ReferenceMatchIterator, to eliminate double reports
 
@@ -228,6 +243,65 @@ protected:
     bool m_reverse;
 };
 
+//////////////////// ReferenceSearch :: ReportedFragments
+
+const unsigned int  ReferenceSearch :: ReportedFragments :: FragmentsPerRow;
+const uint64_t      ReferenceSearch :: ReportedFragments :: RowsPerPage;
+const unsigned int  ReferenceSearch :: ReportedFragments :: ShardCount;
+
+ReferenceSearch :: ReportedFragments :: ReportedFragments ()
+{
+    for ( unsigned int i = 0; i < ShardCount; ++i )
+    {
+        rc_t rc = KLockMake ( & m_shards [ i ] . m_lock );
+        if ( rc != 0 )
+        {
+            while ( i > 0 )
+            {
+                KLockRelease ( m_shards [ --i ] . m_lock );
+            }
+            throw ( ErrorMsg ( "KLockMake failed" ) );
+        }
+    }
+}
+
+ReferenceSearch :: ReportedFragments :: ~ReportedFragments ()
+{
+    for ( unsigned int i = 0; i < ShardCount; ++i )
+    {
+        KLockRelease ( m_shards [ i ] . m_lock );
+    }
+}
+
+bool
+ReferenceSearch :: ReportedFragments :: Insert ( int64_t p_rowId, uint32_t p_fragNum )
+{
+    const uint64_t row = ( uint64_t ) p_rowId;
+    const int64_t pageNum = ( int64_t ) ( row / RowsPerPage );
+    Shard & shard = m_shards [ ( uint64_t ) pageNum % ShardCount ];
+
+    bool ret;
+    KLockAcquire ( shard . m_lock );
+    if ( p_fragNum < FragmentsPerRow )
+    {
+        Page & page = shard . m_pages [ pageNum ];
+        if ( page . empty () )
+        {
+            page . resize ( RowsPerPage * FragmentsPerRow / 64, 0 );
+        }
+        const uint64_t bit = ( row % RowsPerPage ) * FragmentsPerRow + p_fragNum;
+        const uint64_t mask = ( uint64_t ) 1 << ( bit % 64 );
+        ret = ( page [ bit / 64 ] & mask ) == 0;
+        page [ bit / 64 ] |= mask;
+    }
+    else
+    {
+        ret = shard . m_overflow . insert ( make_pair ( p_rowId, p_fragNum ) ) . second;
+    }
+    KLockUnlock ( shard . m_lock );
+    return ret;
+}
+
 //////////////////// ReferenceSearchBuffer
 
 class ReferenceSearchBuffer : public ReferenceSearchBase
@@ -28,6 +28,9 @@
 #define _hpp_reference_match_iterator_
 
 #include <set>
+#include <map>
+#include <vector>
+#include <stdint.h>
 
 #include "searchblock.hpp"
 #include "referencespec.hpp"
@@ -41,7 +44,34 @@ struct KLock;
 class ReferenceSearch : public ThreadableSearch
 {
 public:
-    typedef std :: set < std :: string > ReportedFragments;
+    // fragments reported by all the iterators of an accession, to eliminate double reports
+    // a bit per (row, fragment), in pages of rows allocated on first use, so the memory is bounded by the row count;
+    // pages are spread over shards with a lock each, so that threads rarely wait for each other
+    class ReportedFragments
+    {
+    public:
+        ReportedFragments ();
+        ~ReportedFragments ();
+
+        // false if the fragment has already been reported; p_fragNum counts the biological fragments of the row
+        bool Insert ( int64_t p_rowId, uint32_t p_fragNum );
+
+    private:
+        static const unsigned int FragmentsPerRow   = 4;            // bits per row in a page; the rest go to m_overflow
+        static const uint64_t     RowsPerPage       = 1 << 16;      // 32KB per page
+        static const unsigned int ShardCount        = 64;
+
+        typedef std :: vector < uint64_t > Page;
+
+        struct Shard
+        {
+            struct KLock *                                      m_lock;
+            std :: map < int64_t, Page >                        m_pages;    // by page number
+            std :: set < std :: pair < int64_t, uint32_t > >    m_overflow;
+        };
+
+        Shard m_shards [ ShardCount ];
+    };
 
 public:
     ReferenceSearch ( SearchBlock :: Factory &   p_factory,
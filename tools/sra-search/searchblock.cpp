@@ -27,6 +27,9 @@
 #include "searchblock.hpp"
 
 #include <cstring>
+#include <cctype>
+#include <map>
+#include <algorithm>
 
 #include <klib/rc.h>
 //#include <klib/text.h>
@@ -38,6 +41,11 @@
 
 #include <ngs/ErrorMsg.hpp>
 
+#if defined ( __GNUC__ ) && ( defined ( __x86_64__ ) || defined ( __i386__ ) )
+    #include <tmmintrin.h>
+    #define SSSE3_PACKER 1 // compiled for SSSE3 regardless of the target flags, used if the CPU has it
+#endif
+
 using namespace std;
 using namespace ngs;
 
@@ -57,21 +65,45 @@ ThrowRC(const char* p_message, rc_t p_rc)
 //////////////////// SearchBlock subclasses
 
 FgrepSearch :: FgrepSearch ( const string& p_query, Algorithm p_algorithm )
-: SearchBlock ( p_query )
+:   SearchBlock ( p_query ),
+    m_fgrep ( 0 ),
+    m_matchedQuery ( 0 )
+{
+    m_queries . push_back ( m_query . c_str() );
+    Make ( p_algorithm );
+}
+
+FgrepSearch :: FgrepSearch ( const vector < string >& p_queries, Algorithm p_algorithm )
+:   SearchBlock ( string () ),
+    m_fgrep ( 0 ),
+    m_queryList ( p_queries ),
+    m_matchedQuery ( 0 )
 {
-    m_queries[0] = m_query . c_str();
+    if ( m_queryList . empty () )
+    {
+        throw ( ErrorMsg ( "FgrepSearch: no queries" ) );
+    }
+    for ( vector < string > :: const_iterator i = m_queryList . begin (); i != m_queryList . end (); ++i )
+    {
+        m_queries . push_back ( i -> c_str () );
+    }
+    Make ( p_algorithm );
+}
 
+void
+FgrepSearch :: Make ( Algorithm p_algorithm )
+{
     rc_t rc = 0;
     switch ( p_algorithm )
     {
     case FgrepDumb:
-        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_DUMB, m_queries, 1 );
+        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_DUMB, & m_queries [ 0 ], m_queries . size () );
         break;
     case FgrepBoyerMoore:
-        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_BOYERMOORE, m_queries, 1 );
+        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_BOYERMOORE, & m_queries [ 0 ], m_queries . size () );
         break;
     case FgrepAho:
-        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_AHOCORASICK, m_queries, 1 );
+        rc = FgrepMake ( & m_fgrep, FGREP_MODE_ACGT | FGREP_ALG_AHOCORASICK, & m_queries [ 0 ], m_queries . size () );
         break;
     default:
         throw ( ErrorMsg ( "FgrepSearch: unsupported algorithm" ) );
@@ -94,6 +126,7 @@ FgrepSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t * p_hit
     bool ret = FgrepFindFirst ( m_fgrep, p_bases, p_size, & matchinfo ) != 0;
     if ( ret )
     {
+        m_matchedQuery = matchinfo . whichpattern;
         if ( p_hitStart != 0 )
         {
             * p_hitStart = matchinfo . position;
@@ -162,6 +195,401 @@ AgrepSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t *  p_hi
     return ret;
 }
 
+MultiAgrepSearch :: MultiAgrepSearch ( const vector < string >& p_queries, AgrepSearch :: Algorithm p_algorithm, uint8_t p_minScorePct )
+:   SearchBlock ( string () ),
+    m_minScorePct ( p_minScorePct ),
+    m_matchedQuery ( 0 )
+{
+    if ( p_queries . empty () )
+    {
+        throw ( ErrorMsg ( "MultiAgrepSearch: no queries" ) );
+    }
+
+    // pieces of the same length cannot be found inside one another, so a filter reports candidates in the order of their positions
+    map < size_t, size_t > filterByLength; // piece length to index in m_filters
+    vector < map < string, size_t > > filterIndex; // per filter, piece bases to the filter's query index
+    vector < vector < string > > filterQueries; // per filter
+    for ( size_t i = 0; i < p_queries . size (); ++i )
+    {
+        const size_t querySize = p_queries [ i ] . size ();
+        const size_t errors = querySize * ( 100 - m_minScorePct ) / 100; // same as in AgrepSearch
+        if ( querySize == 0 || errors >= querySize )
+        {
+            throw ( ErrorMsg ( string ( "MultiAgrepSearch: query is too short: '" ) + p_queries [ i ] + "'" ) );
+        }
+        m_errors . push_back ( errors );
+
+        const size_t pieceLength = querySize / ( errors + 1 );
+        map < size_t, size_t > :: const_iterator f = filterByLength . find ( pieceLength );
+        if ( f == filterByLength . end () )
+        {
+            f = filterByLength . insert ( make_pair ( pieceLength, m_filters . size () ) ) . first;
+            Filter filter;
+            filter . m_search = 0;
+            filter . m_maxSpan = 0;
+            m_filters . push_back ( filter );
+            filterIndex . push_back ( map < string, size_t > () );
+            filterQueries . push_back ( vector < string > () );
+        }
+        Filter & filter = m_filters [ f -> second ];
+        filter . m_maxSpan = max ( filter . m_maxSpan, querySize + errors );
+
+        for ( size_t piece = 0; piece <= errors; ++piece )
+        {
+            Piece p;
+            p . m_query = i;
+            p . m_offset = piece * pieceLength;
+            const string bases = p_queries [ i ] . substr ( p . m_offset, pieceLength );
+            map < string, size_t > :: const_iterator it = filterIndex [ f -> second ] . find ( bases );
+            if ( it == filterIndex [ f -> second ] . end () )
+            {
+                it = filterIndex [ f -> second ] . insert ( make_pair ( bases, filterQueries [ f -> second ] . size () ) ) . first;
+                filterQueries [ f -> second ] . push_back ( bases );
+                filter . m_pieces . push_back ( vector < Piece > () );
+            }
+            filter . m_pieces [ it -> second ] . push_back ( p );
+        }
+        m_verify . push_back ( new AgrepSearch ( p_queries [ i ], p_algorithm, m_minScorePct ) );
+    }
+
+    for ( size_t i = 0; i < m_filters . size (); ++i )
+    {
+        m_filters [ i ] . m_search = new FgrepSearch ( filterQueries [ i ], FgrepSearch :: FgrepAho );
+    }
+}
+
+MultiAgrepSearch :: ~MultiAgrepSearch ()
+{
+    for ( vector < Filter > :: iterator i = m_filters . begin (); i != m_filters . end (); ++i )
+    {
+        delete i -> m_search;
+    }
+    for ( vector < AgrepSearch * > :: iterator i = m_verify . begin (); i != m_verify . end (); ++i )
+    {
+        delete * i;
+    }
+}
+
+bool
+MultiAgrepSearch :: FirstMatch ( const Filter & p_filter, const char* p_bases, size_t p_size, bool & p_found, uint64_t & p_bestStart, uint64_t & p_bestEnd )
+{
+    uint64_t pos = 0;
+    uint64_t pieceStart;
+    while ( pos < p_size && p_filter . m_search -> FirstMatch ( p_bases + pos, p_size - pos, & pieceStart ) )
+    {
+        pieceStart += pos;
+        if ( p_found && pieceStart > p_bestStart + p_filter . m_maxSpan )
+        {   // a match containing this or any later piece would start after the best one
+            break;
+        }
+
+        const vector < Piece > & pieces = p_filter . m_pieces [ p_filter . m_search -> MatchedQuery () ];
+        for ( vector < Piece > :: const_iterator i = pieces . begin (); i != pieces . end (); ++i )
+        {
+            // with up to m_errors insertions/deletions the query can be shifted by as much around the piece
+            const size_t errors = m_errors [ i -> m_query ];
+            const size_t querySize = m_verify [ i -> m_query ] -> GetQuery () . size ();
+            const uint64_t from = pieceStart > i -> m_offset + errors ? pieceStart - i -> m_offset - errors : 0;
+            const uint64_t to = min ( ( uint64_t ) p_size, pieceStart - i -> m_offset + querySize + errors );
+
+            uint64_t hitStart;
+            uint64_t hitEnd;
+            if ( m_verify [ i -> m_query ] -> FirstMatch ( p_bases + from, to - from, & hitStart, & hitEnd ) )
+            {
+                if ( ! p_found || from + hitStart < p_bestStart )
+                {
+                    p_found = true;
+                    p_bestStart = from + hitStart;
+                    p_bestEnd = from + hitEnd;
+                    m_matchedQuery = i -> m_query;
+                }
+            }
+        }
+
+        pos = pieceStart + 1;
+    }
+    return p_found;
+}
+
+bool
+MultiAgrepSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t * p_hitStart, uint64_t * p_hitEnd )
+{
+    bool found = false;
+    uint64_t bestStart = 0;
+    uint64_t bestEnd = 0;
+    for ( vector < Filter > :: const_iterator i = m_filters . begin (); i != m_filters . end (); ++i )
+    {
+        FirstMatch ( * i, p_bases, p_size, found, bestStart, bestEnd );
+    }
+
+    if ( found )
+    {
+        if ( p_hitStart != 0 )
+        {
+            * p_hitStart = bestStart;
+        }
+        if ( p_hitEnd != 0 )
+        {
+            * p_hitEnd = bestEnd;
+        }
+    }
+    return found;
+}
+
+//////////////////// MyersSearch
+
+// one text column of one block of 64 query bases; p_hin/return value are the horizontal deltas coming in at the block's bottom
+// and going out at p_outBit (Hyyro, "A bit-vector algorithm for computing Levenshtein and Damerau edit distances", as in Edlib)
+static inline
+int
+MyersAdvanceBlock ( uint64_t & p_pv, uint64_t & p_mv, uint64_t p_eq, int p_hin, uint64_t p_outBit )
+{
+    const uint64_t xv = p_eq | p_mv;
+    if ( p_hin < 0 )
+    {
+        p_eq |= 1;
+    }
+    const uint64_t xh = ( ( ( p_eq & p_pv ) + p_pv ) ^ p_pv ) | p_eq;
+    uint64_t ph = p_mv | ~ ( xh | p_pv );
+    uint64_t mh = p_pv & xh;
+
+    const int hout = ( ph & p_outBit ) ? 1 : ( ( mh & p_outBit ) ? -1 : 0 );
+
+    ph <<= 1;
+    mh <<= 1;
+    if ( p_hin < 0 )
+    {
+        mh |= 1;
+    }
+    else if ( p_hin > 0 )
+    {
+        ph |= 1;
+    }
+    p_pv = mh | ~ ( xv | ph );
+    p_mv = ph & xv;
+    return hout;
+}
+
+static const uint64_t MyersHighBit = ( uint64_t ) 1 << 63;
+
+// one text column of a query of up to 64 bases, without branches; p_score is the edit distance at p_lastBit
+static inline
+void
+MyersAdvance ( uint64_t & p_pv, uint64_t & p_mv, size_t & p_score, uint64_t p_eq, uint64_t p_lastBit )
+{
+    const uint64_t xv = p_eq | p_mv;
+    const uint64_t xh = ( ( ( p_eq & p_pv ) + p_pv ) ^ p_pv ) | p_eq;
+    const uint64_t ph = p_mv | ~ ( xh | p_pv );
+    const uint64_t mh = p_pv & xh;
+    p_score += ( size_t ) ( ( ph & p_lastBit ) != 0 ) - ( size_t ) ( ( mh & p_lastBit ) != 0 );
+    p_pv = ( mh << 1 ) | ~ ( xv | ( ph << 1 ) );
+    p_mv = ( ph << 1 ) & xv;
+}
+
+MyersSearch :: MyersSearch ( const string& p_query, uint8_t p_minScorePct )
+:   SearchBlock ( p_query ),
+    m_blocks ( ( p_query . size () + 63 ) / 64 ),
+    m_lastBit ( ( uint64_t ) 1 << ( ( p_query . size () + 63 ) % 64 ) ),
+    m_errors ( p_query . size () * ( 100 - p_minScorePct ) / 100 ), // same as in AgrepSearch
+    m_minScorePct ( p_minScorePct ),
+    m_peq ( 256 * m_blocks, 0 ),
+    m_pv ( m_blocks ),
+    m_mv ( m_blocks ),
+    m_column ( p_query . size () + 1 )
+{
+    if ( m_query . empty () )
+    {
+        throw ( ErrorMsg ( "MyersSearch: empty query" ) );
+    }
+
+    for ( size_t i = 0; i < m_query . size (); ++i )
+    {
+        const uint64_t bit = ( uint64_t ) 1 << ( i % 64 );
+        const unsigned char ch = m_query [ i ];
+        m_peq [ toupper ( ch ) * m_blocks + i / 64 ] |= bit;
+        m_peq [ tolower ( ch ) * m_blocks + i / 64 ] |= bit;
+    }
+}
+
+MyersSearch :: ~MyersSearch ()
+{
+}
+
+bool
+MyersSearch :: FindEnd ( const char* p_bases, size_t p_size, uint64_t & p_end )
+{
+    vector < uint64_t > & pv = m_pv;
+    vector < uint64_t > & mv = m_mv;
+    fill ( pv . begin (), pv . end (), ~ ( uint64_t ) 0 );
+    fill ( mv . begin (), mv . end (), 0 );
+    size_t score = m_query . size ();
+    const size_t last = m_blocks - 1;
+    for ( size_t pos = 0; pos < p_size; ++pos )
+    {
+        const uint64_t * eq = & m_peq [ ( unsigned char ) p_bases [ pos ] * m_blocks ];
+        int carry = 0;
+        for ( size_t b = 0; b < last; ++b )
+        {
+            carry = MyersAdvanceBlock ( pv [ b ], mv [ b ], eq [ b ], carry, MyersHighBit );
+        }
+        score += MyersAdvanceBlock ( pv [ last ], mv [ last ], eq [ last ], carry, m_lastBit );
+        if ( score <= m_errors )
+        {
+            p_end = pos + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t
+MyersSearch :: FindStart ( const char* p_bases, uint64_t p_end )
+{   // edit distances of the query to the text ending at p_end, by the length of the text; the smallest distance, longest text wins
+    const size_t querySize = m_query . size ();
+    const size_t maxLength = min ( ( size_t ) p_end, querySize + m_errors );
+
+    // m_column [ i ]: distance between the last i bases of the query and the last j bases of the text
+    for ( size_t i = 0; i <= querySize; ++i )
+    {
+        m_column [ i ] = i;
+    }
+
+    unsigned int bestDistance = m_column [ querySize ];
+    size_t bestLength = 0;
+    for ( size_t j = 1; j <= maxLength; ++j )
+    {
+        const unsigned char ch = p_bases [ p_end - j ];
+        unsigned int diagonal = m_column [ 0 ];
+        m_column [ 0 ] = j;
+        for ( size_t i = 1; i <= querySize; ++i )
+        {
+            const size_t qpos = querySize - i;
+            const bool same = ( m_peq [ ch * m_blocks + qpos / 64 ] >> ( qpos % 64 ) ) & 1;
+            const unsigned int value = min ( min ( m_column [ i ], m_column [ i - 1 ] ) + 1, diagonal + ( same ? 0 : 1 ) );
+            diagonal = m_column [ i ];
+            m_column [ i ] = value;
+        }
+        if ( m_column [ querySize ] <= bestDistance )
+        {
+            bestDistance = m_column [ querySize ];
+            bestLength = j;
+        }
+    }
+    return p_end - bestLength;
+}
+
+bool
+MyersSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t * p_hitStart, uint64_t * p_hitEnd )
+{
+    uint64_t end;
+    if ( ! FindEnd ( p_bases, p_size, end ) )
+    {
+        return false;
+    }
+    if ( p_hitStart != 0 )
+    {
+        * p_hitStart = FindStart ( p_bases, end );
+    }
+    if ( p_hitEnd != 0 )
+    {
+        * p_hitEnd = end;
+    }
+    return true;
+}
+
+void
+MyersSearch :: FirstMatches ( const char * const * p_bases, const size_t * p_sizes, size_t p_count, vector < size_t > & p_matched )
+{
+    if ( m_blocks != 1 || p_count < Lanes )
+    {
+        SearchBlock :: FirstMatches ( p_bases, p_sizes, p_count, p_matched );
+        return;
+    }
+
+    // a base of every lane's fragment per step: the lanes' bit-vector updates do not depend on each other and overlap in the CPU.
+    // only whether a fragment matches is needed, so a lane scans its fragment to the end and then takes the next one
+    const char * bases [ Lanes ];
+    size_t left [ Lanes ];          // bases to scan
+    size_t fragment [ Lanes ];
+    uint64_t pv [ Lanes ];
+    uint64_t mv [ Lanes ];
+    size_t score [ Lanes ];
+    bool found [ Lanes ];
+
+    m_found . assign ( p_count, false );
+    size_t next = 0;
+    for ( size_t l = 0; l < Lanes; ++l, ++next )
+    {
+        bases [ l ] = p_bases [ next ];
+        left [ l ] = p_sizes [ next ];
+        fragment [ l ] = next;
+        pv [ l ] = ~ ( uint64_t ) 0;
+        mv [ l ] = 0;
+        score [ l ] = m_query . size ();
+        found [ l ] = false;
+    }
+
+    bool full = true;
+    while ( full )
+    {
+        const size_t steps = * min_element ( left, left + Lanes );
+        for ( size_t pos = 0; pos < steps; ++pos )
+        {
+            for ( size_t l = 0; l < Lanes; ++l )
+            {
+                MyersAdvance ( pv [ l ], mv [ l ], score [ l ], m_peq [ ( unsigned char ) bases [ l ] [ pos ] ], m_lastBit );
+                found [ l ] |= score [ l ] <= m_errors;
+            }
+        }
+
+        for ( size_t l = 0; l < Lanes; ++l )
+        {
+            bases [ l ] += steps;
+            left [ l ] -= steps;
+            if ( left [ l ] == 0 && full )
+            {
+                m_found [ fragment [ l ] ] = found [ l ];
+                if ( next == p_count )
+                {   // the other lanes are finished one by one
+                    fragment [ l ] = p_count;
+                    full = false;
+                    continue;
+                }
+                bases [ l ] = p_bases [ next ];
+                left [ l ] = p_sizes [ next ];
+                fragment [ l ] = next;
+                pv [ l ] = ~ ( uint64_t ) 0;
+                mv [ l ] = 0;
+                score [ l ] = m_query . size ();
+                found [ l ] = false;
+                ++ next;
+            }
+        }
+    }
+
+    for ( size_t l = 0; l < Lanes; ++l )
+    {
+        if ( fragment [ l ] == p_count )
+        {
+            continue;
+        }
+        for ( size_t pos = 0; pos < left [ l ]; ++pos )
+        {
+            MyersAdvance ( pv [ l ], mv [ l ], score [ l ], m_peq [ ( unsigned char ) bases [ l ] [ pos ] ], m_lastBit );
+            found [ l ] |= score [ l ] <= m_errors;
+        }
+        m_found [ fragment [ l ] ] = found [ l ];
+    }
+
+    for ( size_t i = 0; i < p_count; ++i )
+    {
+        if ( m_found [ i ] )
+        {
+            p_matched . push_back ( i );
+        }
+    }
+}
+
 NucStrstrSearch :: NucStrstrSearch ( const string& p_query, bool p_positional, bool p_useBlobSearch )
 :   SearchBlock ( p_query ),
     m_positional ( p_positional || p_useBlobSearch ) // when searching blob-by-blob, have to use positional mode since it reports position of the match, required in blob mode
@@ -188,11 +616,14 @@ NucStrstrSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t * p
 
     // convert p_bases to 2na packed since nucstrstr works with that format only
     const size_t bufSize = p_size / 4 + 1 + 16; // NucStrstrSearch expects the buffer to be at least 16 bytes longer than the sequence
-    unsigned char* buf2na = new unsigned char [ bufSize ];
-    ConvertAsciiTo2NAPacked ( p_bases, p_size, buf2na, bufSize );
+    if ( m_buf2na . size () < bufSize )
+    {
+        m_buf2na . resize ( bufSize );
+    }
+    ConvertAsciiTo2NAPacked ( p_bases, p_size, & m_buf2na [ 0 ], bufSize );
 
     unsigned int selflen;
-    int pos = ::NucStrstrSearch ( m_nss, reinterpret_cast < const void * > ( buf2na ), 0, p_size, & selflen );
+    int pos = ::NucStrstrSearch ( m_nss, reinterpret_cast < const void * > ( & m_buf2na [ 0 ] ), 0, p_size, & selflen );
     bool ret = pos > 0;
     if ( ret )
     {
@@ -205,34 +636,103 @@ NucStrstrSearch :: FirstMatch ( const char* p_bases, size_t p_size, uint64_t * p
             * p_hitEnd = pos - 1 + selflen;
         }
     }
-    delete [] buf2na;
     return ret;
 }
 
+// ACGT/acgt to 2na, anything else to 0 (same as A)
+static
+struct AsciiTo2NA
+{
+    unsigned char code [ 256 ];
+
+    AsciiTo2NA ()
+    {
+        fill ( code, code + 256, 0 );
+        code [ ( unsigned char ) 'A' ] = code [ ( unsigned char ) 'a' ] = 0;
+        code [ ( unsigned char ) 'C' ] = code [ ( unsigned char ) 'c' ] = 1;
+        code [ ( unsigned char ) 'G' ] = code [ ( unsigned char ) 'g' ] = 2;
+        code [ ( unsigned char ) 'T' ] = code [ ( unsigned char ) 't' ] = 3;
+    }
+
+    unsigned char operator [] ( char ch ) const { return code [ ( unsigned char ) ch ]; }
+} Ascii2NA;
+
+#if SSSE3_PACKER
+// packs 16 bases at a time, returns the number of bases packed (a multiple of 16)
+__attribute__ ( ( target ( "ssse3" ) ) )
+static
+size_t
+PackSSSE3 ( const char* p_read, size_t p_len, unsigned char* p_buf )
+{
+    // 2na code by the low nibble: A = 1, C = 3, T = 4, G = 7, the same for the lower case
+    const __m128i lookup    = _mm_setr_epi8 ( 0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0 );
+    const __m128i lowNibble = _mm_set1_epi8 ( 0x0F );
+    const __m128i toLower   = _mm_set1_epi8 ( 0x20 );
+    const __m128i a = _mm_set1_epi8 ( 'a' );
+    const __m128i c = _mm_set1_epi8 ( 'c' );
+    const __m128i g = _mm_set1_epi8 ( 'g' );
+    const __m128i t = _mm_set1_epi8 ( 't' );
+    const __m128i pairs     = _mm_setr_epi8 ( 4, 1, 4, 1, 4, 1, 4, 1, 4, 1, 4, 1, 4, 1, 4, 1 ); // b0 * 4 + b1
+    const __m128i quads     = _mm_setr_epi16 ( 16, 1, 16, 1, 16, 1, 16, 1 );                      // ( b0 * 4 + b1 ) * 16 + b2 * 4 + b3
+    const __m128i gather    = _mm_setr_epi8 ( 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+
+    size_t i = 0;
+    for ( ; i + 16 <= p_len; i += 16 )
+    {
+        const __m128i ch = _mm_loadu_si128 ( reinterpret_cast < const __m128i * > ( p_read + i ) );
+        const __m128i lower = _mm_or_si128 ( ch, toLower );
+        const __m128i valid = _mm_or_si128 ( _mm_or_si128 ( _mm_cmpeq_epi8 ( lower, a ), _mm_cmpeq_epi8 ( lower, c ) ),
+                                             _mm_or_si128 ( _mm_cmpeq_epi8 ( lower, g ), _mm_cmpeq_epi8 ( lower, t ) ) );
+        const __m128i codes = _mm_and_si128 ( _mm_shuffle_epi8 ( lookup, _mm_and_si128 ( ch, lowNibble ) ), valid );
+        const __m128i packed = _mm_madd_epi16 ( _mm_maddubs_epi16 ( codes, pairs ), quads );
+        const int32_t word = _mm_cvtsi128_si32 ( _mm_shuffle_epi8 ( packed, gather ) );
+        memcpy ( p_buf + i / 4, & word, sizeof ( word ) );
+    }
+    return i;
+}
+
+static
+bool
+HasSSSE3 ()
+{
+    static const bool ret = __builtin_cpu_supports ( "ssse3" );
+    return ret;
+}
+#endif
+
 void
 NucStrstrSearch :: ConvertAsciiTo2NAPacked ( const char* pszRead, size_t nReadLen, unsigned char* pBuf2NA, size_t nBuf2NASize )
 {
-    static unsigned char map [ 1 << ( sizeof ( char ) * 8 ) ];
-    map['A'] = map['a'] = 0;
-    map['C'] = map['c'] = 1;
-    map['G'] = map['g'] = 2;
-    map['T'] = map['t'] = 3;
+    assert ( nBuf2NASize >= ( nReadLen + 3 ) / 4 );
 
-    static size_t shiftLeft [ 4 ] = { 6, 4, 2, 0 };
-
-    fill ( pBuf2NA, pBuf2NA + nBuf2NASize, 0 );
+    size_t iChar = 0;
+#if SSSE3_PACKER
+    if ( HasSSSE3 () )
+    {
+        iChar = PackSSSE3 ( pszRead, nReadLen, pBuf2NA );
+    }
+#endif
 
-    for ( size_t iChar = 0; iChar < nReadLen; ++iChar )
+    for ( ; iChar + 4 <= nReadLen; iChar += 4 )
     {
-        size_t iByte = iChar / 4;
-        if ( iByte > nBuf2NASize )
+        pBuf2NA [ iChar / 4 ] = ( Ascii2NA [ pszRead [ iChar ] ] << 6 ) |
+                                ( Ascii2NA [ pszRead [ iChar + 1 ] ] << 4 ) |
+                                ( Ascii2NA [ pszRead [ iChar + 2 ] ] << 2 ) |
+                                  Ascii2NA [ pszRead [ iChar + 3 ] ];
+    }
+
+    size_t iByte = iChar / 4;
+    if ( iChar < nReadLen )
+    {   // the last partial byte
+        unsigned char last = 0;
+        for ( unsigned int shift = 6; iChar < nReadLen; ++iChar, shift -= 2 )
         {
-            assert ( false );
-            break;
+            last |= Ascii2NA [ pszRead [ iChar ] ] << shift;
         }
-
-        pBuf2NA[iByte] |= map [ size_t ( pszRead [ iChar ] ) ] << shiftLeft [ iChar % 4 ];
+        pBuf2NA [ iByte ++ ] = last;
     }
+
+    fill ( pBuf2NA + iByte, pBuf2NA + nBuf2NASize, 0 );
 }
 
 SmithWatermanSearch :: SmithWatermanSearch ( const string& p_query, uint8_t p_minScorePct )
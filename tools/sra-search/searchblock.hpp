@@ -28,6 +28,7 @@
 #define _hpp_searchblock_
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 struct Fgrep;
@@ -50,6 +51,26 @@ public:
 
     virtual bool FirstMatch ( const char * p_bases, size_t p_size, uint64_t * hitStart = 0, uint64_t * hitEnd = 0 ) = 0;
 
+    // index of the query found by the last successful FirstMatch(); always 0 for single query searches
+    virtual size_t MatchedQuery () const { return 0; }
+
+    // searches p_count fragments, appends the indexes of the ones that have a match to p_matched, in order;
+    // one FirstMatch() per fragment unless the search can do better (see BatchSize())
+    virtual void FirstMatches ( const char * const * p_bases, const size_t * p_sizes, size_t p_count, std :: vector < size_t > & p_matched )
+    {
+        for ( size_t i = 0; i < p_count; ++i )
+        {
+            if ( FirstMatch ( p_bases [ i ], p_sizes [ i ] ) )
+            {
+                p_matched . push_back ( i );
+            }
+        }
+    }
+
+    // fragments to pass to FirstMatches() at once; 1 if that is no faster than a FirstMatch() per fragment.
+    // FirstMatches() does not tell which query matched, so only single query searches return more than 1
+    virtual size_t BatchSize () const { return 1; }
+
 public:
     class Factory
     {
@@ -77,13 +98,21 @@ public:
 
 public:
     FgrepSearch ( const std::string& p_query, Algorithm p_algorithm );
+    // all queries are searched for at once (a single automaton for FgrepAho)
+    FgrepSearch ( const std::vector < std::string >& p_queries, Algorithm p_algorithm );
     virtual ~FgrepSearch ();
 
     virtual bool FirstMatch ( const char * p_bases, size_t p_size, uint64_t * hitStart = 0, uint64_t * hitEnd = 0 );
 
+    virtual size_t MatchedQuery () const { return m_matchedQuery; }
+
 private:
-    struct Fgrep*   m_fgrep;
-    const char*     m_queries[1];
+    void Make ( Algorithm p_algorithm );
+
+    struct Fgrep*                   m_fgrep;
+    std::vector < std::string >     m_queryList;
+    std::vector < const char * >    m_queries;
+    size_t                          m_matchedQuery;
 };
 
 class AgrepSearch : public SearchBlock
@@ -110,6 +139,79 @@ private:
     uint8_t         m_minScorePct;
 };
 
+// approximate search for multiple queries in one pass:
+// with up to K errors, a match contains at least one of K+1 pieces of the query exactly,
+// so an Aho-Corasick scan for the pieces of the queries finds candidates, verified by Agrep around each candidate;
+// queries are grouped by the length of their pieces, one scan per group, so a short query does not shorten the pieces of the others
+class MultiAgrepSearch : public SearchBlock
+{
+public:
+    MultiAgrepSearch ( const std::vector < std::string >& p_queries, AgrepSearch :: Algorithm p_algorithm, uint8_t p_minScorePct );
+    virtual ~MultiAgrepSearch ();
+
+    virtual unsigned int GetScoreThreshold () { return m_minScorePct; }
+
+    // reports the leftmost match of any query
+    virtual bool FirstMatch ( const char * p_bases, size_t p_size, uint64_t * hitStart = 0, uint64_t * hitEnd = 0 );
+
+    virtual size_t MatchedQuery () const { return m_matchedQuery; }
+
+private:
+    struct Piece
+    {
+        size_t m_query;
+        size_t m_offset; // in the query
+    };
+
+    struct Filter
+    {
+        FgrepSearch*                            m_search;   // pieces of the group's queries, all of the same length
+        std::vector < std::vector < Piece > >   m_pieces;   // indexed by m_search's query index
+        size_t                                  m_maxSpan;  // the longest possible match of the group's queries
+    };
+
+    bool FirstMatch ( const Filter & p_filter, const char * p_bases, size_t p_size, bool & p_found, uint64_t & p_bestStart, uint64_t & p_bestEnd );
+
+    std::vector < Filter >              m_filters;  // one per piece length
+    std::vector < AgrepSearch * >       m_verify;   // indexed by query
+    std::vector < size_t >              m_errors;   // allowed errors, indexed by query
+    uint8_t                             m_minScorePct;
+    size_t                              m_matchedQuery;
+};
+
+// native approximate search, Myers' bit-vector algorithm (query in blocks of 64 bases, Hyyro's extension for longer queries)
+// reports the first match to end, starting where the edit distance to the query is the smallest
+class MyersSearch : public SearchBlock
+{
+public:
+    MyersSearch ( const std::string& p_query, uint8_t p_minScorePct );
+    virtual ~MyersSearch ();
+
+    virtual unsigned int GetScoreThreshold () { return m_minScorePct; }
+
+    virtual bool FirstMatch ( const char * p_bases, size_t p_size, uint64_t * hitStart = 0, uint64_t * hitEnd = 0 );
+
+    // queries of up to 64 bases scan Lanes fragments side by side
+    virtual void FirstMatches ( const char * const * p_bases, const size_t * p_sizes, size_t p_count, std::vector < size_t > & p_matched );
+    virtual size_t BatchSize () const { return m_blocks == 1 ? 64 : 1; }
+
+private:
+    static const size_t Lanes = 4;
+
+    bool FindEnd ( const char * p_bases, size_t p_size, uint64_t & p_end );
+    uint64_t FindStart ( const char * p_bases, uint64_t p_end );
+
+    size_t                      m_blocks;       // of 64 query bases
+    uint64_t                    m_lastBit;      // the query's last base in the last block
+    unsigned int                m_errors;       // allowed edit distance
+    uint8_t                     m_minScorePct;
+    std::vector < uint64_t >    m_peq;          // [ 256 * m_blocks ], query positions of every character
+    std::vector < uint64_t >    m_pv;           // FindEnd scratch, [ m_blocks ]
+    std::vector < uint64_t >    m_mv;           // FindEnd scratch, [ m_blocks ]
+    std::vector < unsigned int > m_column;      // FindStart scratch
+    std::vector < bool >        m_found;        // FirstMatches scratch, by fragment
+};
+
 class NucStrstrSearch : public SearchBlock
 {
 public:
@@ -121,8 +223,9 @@ public:
 private:
     static void ConvertAsciiTo2NAPacked ( const char* pszRead, size_t nReadLen, unsigned char* pBuf2NA, size_t nBuf2NASize );
 
-    bool                m_positional;
-    union NucStrstr*    m_nss;
+    bool                            m_positional;
+    union NucStrstr*                m_nss;
+    std :: vector < unsigned char > m_buf2na; // 2na packed bases, reused between calls
 };
 
 class SmithWatermanSearch : public SearchBlock
@@ -38,16 +38,18 @@ class SearchBuffer
 public:
     struct Match
     {
-        Match( const std :: string & p_accession, const std :: string & p_fragmentId, const std :: string & p_bases )
+        Match( const std :: string & p_accession, const std :: string & p_fragmentId, const std :: string & p_bases, size_t p_queryIndex = 0 )
         :   m_accession ( p_accession ),
             m_fragmentId ( p_fragmentId ),
-            m_bases ( p_bases )
+            m_bases ( p_bases ),
+            m_queryIndex ( p_queryIndex )
         {
         }
 
         std :: string   m_accession;
         std :: string   m_fragmentId;
         std :: string   m_bases;
+        size_t          m_queryIndex; // see SearchBlock :: MatchedQuery ()
     };
 
 public:
@@ -43,6 +43,24 @@ TEST_CASE ( FgrepDumb )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchFgrepDumb_MultipleQueries )
+{
+    vector < string > queries;
+    queries . push_back ( "GTCA" );
+    queries . push_back ( "CTA" );
+    FgrepSearch sb ( queries, FgrepSearch :: FgrepDumb );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACTGACTAGTCA";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)5, hitStart );
+    REQUIRE_EQ ( (uint64_t)8, hitEnd );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+
+    REQUIRE ( sb.FirstMatch ( Bases.c_str() + hitEnd, Bases.size() - hitEnd, & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)0, sb.MatchedQuery() );
+}
+
 TEST_CASE ( SearchFgrepBoyerMoore )
 {
     FgrepSearch sb ( "CTA", FgrepSearch :: FgrepBoyerMoore );
@@ -54,6 +72,24 @@ TEST_CASE ( SearchFgrepBoyerMoore )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchFgrepBoyerMoore_MultipleQueries )
+{
+    vector < string > queries;
+    queries . push_back ( "GTCA" );
+    queries . push_back ( "CTA" );
+    FgrepSearch sb ( queries, FgrepSearch :: FgrepBoyerMoore );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACTGACTAGTCA";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)5, hitStart );
+    REQUIRE_EQ ( (uint64_t)8, hitEnd );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+
+    REQUIRE ( sb.FirstMatch ( Bases.c_str() + hitEnd, Bases.size() - hitEnd, & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)0, sb.MatchedQuery() );
+}
+
 TEST_CASE ( SearchFgrepAho )
 {
     FgrepSearch sb ( "CTA", FgrepSearch :: FgrepAho );
@@ -65,6 +101,24 @@ TEST_CASE ( SearchFgrepAho )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchFgrepAho_MultipleQueries )
+{
+    vector < string > queries;
+    queries . push_back ( "GTCA" );
+    queries . push_back ( "CTA" );
+    FgrepSearch sb ( queries, FgrepSearch :: FgrepAho );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACTGACTAGTCA";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)5, hitStart );
+    REQUIRE_EQ ( (uint64_t)8, hitEnd );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+
+    REQUIRE ( sb.FirstMatch ( Bases.c_str() + hitEnd, Bases.size() - hitEnd, & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)0, sb.MatchedQuery() );
+}
+
 TEST_CASE ( SearchAgrepDP )
 {
     AgrepSearch sb ( "CTA", AgrepSearch :: AgrepDP, 100 );
@@ -76,6 +130,66 @@ TEST_CASE ( SearchAgrepDP )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchMultiAgrep_Exact )
+{
+    vector < string > queries;
+    queries . push_back ( "TTTT" );
+    queries . push_back ( "CTA" );
+    MultiAgrepSearch sb ( queries, AgrepSearch :: AgrepDP, 100 );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACTGACTAGTCA";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)5, hitStart );
+    REQUIRE_EQ ( (uint64_t)8, hitEnd );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+}
+
+TEST_CASE ( SearchMultiAgrep_Mismatch_Leftmost )
+{
+    vector < string > queries;
+    queries . push_back ( "GTCAGGTACC" );
+    queries . push_back ( "ACTGACTAGT" );
+    MultiAgrepSearch sb ( queries, AgrepSearch :: AgrepMyers, 90 ); // 1 error in 10 bases
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "TTACTGACAAGTCAGGTACC";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+    REQUIRE_EQ ( (uint64_t)2, hitStart );
+    REQUIRE_EQ ( (uint64_t)12, hitEnd );
+}
+
+TEST_CASE ( SearchMultiAgrep_PieceLengths )
+{   // a short query gets its own filter, the long one still matches leftmost with errors
+    vector < string > queries;
+    queries . push_back ( "GTCAGGTACCATTGCAGTCA" );
+    queries . push_back ( "TTTTT" );
+    MultiAgrepSearch sb ( queries, AgrepSearch :: AgrepMyers, 90 ); // 2 errors in 20 bases, none in 5
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACGTCAGGAACCATTGCTGTCAAATTTTTAA"; // 2 mismatches, so no other start is within 2 errors
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)0, sb.MatchedQuery() );
+    REQUIRE_EQ ( (uint64_t)2, hitStart );
+    REQUIRE_EQ ( (uint64_t)22, hitEnd );
+
+    const string Short = "ACGTCAGGAACCAATTTTTAA";
+    REQUIRE ( sb.FirstMatch ( Short.c_str(), Short.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (size_t)1, sb.MatchedQuery() );
+    REQUIRE_EQ ( (uint64_t)14, hitStart );
+}
+
+TEST_CASE ( SearchMultiAgrep_NotFound )
+{
+    vector < string > queries;
+    queries . push_back ( "GGGGGGGGGG" );
+    queries . push_back ( "CCCCCCCCCC" );
+    MultiAgrepSearch sb ( queries, AgrepSearch :: AgrepMyers, 90 );
+    const string Bases = "ACTGACTAGTCAGGGGCGGGTGGG";
+    REQUIRE ( ! sb.FirstMatch ( Bases.c_str(), Bases.size() ) );
+}
+
 TEST_CASE ( SearchNucStrstr_NoExpr_NoCoords )
 {
     NucStrstrSearch sb ( "CTA", false );
@@ -103,6 +217,21 @@ TEST_CASE ( SearchNucStrstr_Expr_Coords )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchNucStrstr_Expr_Coords_Long )
+{   // longer than one packing step, mixed case, reusing the conversion buffer
+    NucStrstrSearch sb ( "CTA", true );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "acgtacgtacgtacgtACGTACGTACGTACGTGGCTAGG";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)34, hitStart );
+    REQUIRE_EQ ( (uint64_t)37, hitEnd );
+
+    REQUIRE ( sb.FirstMatch ( Bases.c_str() + 1, Bases.size() - 1, & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)33, hitStart );
+    REQUIRE ( ! sb.FirstMatch ( Bases.c_str(), 34 ) );
+}
+
 TEST_CASE ( SearchSmithWaterman_Coords_NotSupported )
 {
     SmithWatermanSearch sb ( "CTA", 100 );
@@ -114,6 +243,95 @@ TEST_CASE ( SearchSmithWaterman_Coords_NotSupported )
     REQUIRE_EQ ( (uint64_t)8, hitEnd );
 }
 
+TEST_CASE ( SearchMyers_Exact )
+{
+    MyersSearch sb ( "CTA", 100 );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "ACTGACTAGTCA";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)5, hitStart );
+    REQUIRE_EQ ( (uint64_t)8, hitEnd );
+    REQUIRE ( ! sb.FirstMatch ( Bases.c_str(), 7 ) );
+}
+
+TEST_CASE ( SearchMyers_Mismatch )
+{
+    MyersSearch sb ( "ACGTTGCA", 80 ); // 1 error
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "GGGGacgaTGCAGGGG";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)4, hitStart );
+    REQUIRE_EQ ( (uint64_t)12, hitEnd );
+}
+
+TEST_CASE ( SearchMyers_Deletion_LongQuery )
+{   // more than 64 bases, several blocks
+    const string Query = "ACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCA"; // 80
+    MyersSearch sb ( Query, 98 ); // 1 error
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    const string Bases = "GGGG" + Query . substr ( 0, 70 ) + Query . substr ( 71 ) + "GGGG";
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)4, hitStart );
+    REQUIRE_EQ ( (uint64_t)83, hitEnd );
+
+    const string Bases2 = "GGGG" + Query . substr ( 0, 70 ) + Query . substr ( 72 ) + "GGGG"; // 2 errors
+    REQUIRE ( ! sb.FirstMatch ( Bases2.c_str(), Bases2.size() ) );
+}
+
+TEST_CASE ( SearchMyers_LongBuffer )
+{   // of several matches in a long buffer, the leftmost one is reported, in either case
+    MyersSearch sb ( "CTAGCTAG", 100 );
+    uint64_t hitStart = 0;
+    uint64_t hitEnd = 0;
+    string Bases ( 40000, 'A' );
+    Bases . replace ( 35000, 8, "CTAGCTAG" );
+    Bases . replace ( 20001, 8, "ctagctag" );
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)20001, hitStart );
+    REQUIRE_EQ ( (uint64_t)20009, hitEnd );
+
+    Bases . replace ( 4999, 8, "CTAGCTAG" ); // now the leftmost
+    REQUIRE ( sb.FirstMatch ( Bases.c_str(), Bases.size(), & hitStart, & hitEnd ) );
+    REQUIRE_EQ ( (uint64_t)4999, hitStart );
+}
+
+TEST_CASE ( SearchMyers_FirstMatches )
+{   // fragments of different lengths in a batch, the same as one FirstMatch per fragment
+    MyersSearch sb ( "ACGTTGCA", 80 ); // 1 error
+    vector < string > fragments;
+    fragments . push_back ( "TTTTTTTTTTTTTTTTTTTTTTTTTTTTTT" );
+    fragments . push_back ( "ACGTTGCA" );
+    fragments . push_back ( "" );
+    fragments . push_back ( "GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGACGTAGCAGG" ); // 1 error at the end of a long fragment
+    fragments . push_back ( "ACG" );
+    fragments . push_back ( "TTTTACGTTGCATT" );
+    fragments . push_back ( "CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCC" );
+    fragments . push_back ( "ACGATGCA" ); // 1 error
+    fragments . push_back ( "ACAATGCA" ); // 2 errors
+    fragments . push_back ( "acgttgca" );
+
+    vector < const char * > bases;
+    vector < size_t > sizes;
+    vector < size_t > expected;
+    for ( size_t i = 0; i < fragments . size (); ++i )
+    {
+        bases . push_back ( fragments [ i ] . data () );
+        sizes . push_back ( fragments [ i ] . size () );
+        if ( sb.FirstMatch ( fragments [ i ] . data (), fragments [ i ] . size () ) )
+        {
+            expected . push_back ( i );
+        }
+    }
+    REQUIRE_EQ ( (size_t)5, expected . size () );
+
+    vector < size_t > matched;
+    sb.FirstMatches ( & bases [ 0 ], & sizes [ 0 ], bases . size (), matched );
+    REQUIRE ( expected == matched );
+}
+
 #if WIN32
     #define main wmain
 #endif
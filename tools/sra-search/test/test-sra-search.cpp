@@ -29,6 +29,9 @@
 #include "referencematchiterator.hpp"
 
 #include <set>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
 
 #include <ktst/unit_test.hpp>
 
@@ -133,6 +136,185 @@ FIXTURE_TEST_CASE ( SupportedAlgorithms, VdbSearchFixture )
     REQUIRE_LT ( ( size_t ) 0, algs . size () );
 }
 
+TEST_CASE ( LoadQueries_Fasta )
+{
+    const string FileName = "queries.fa.tmp";
+    {
+        ofstream out ( FileName . c_str () );
+        out << ">primer1 forward" << endl << "ACGT" << endl << "ACGT" << endl << ">primer2" << endl << "TTTT" << endl;
+    }
+    VdbSearch :: Settings s;
+    REQUIRE ( s . LoadQueries ( FileName ) );
+    remove ( FileName . c_str () );
+    REQUIRE_EQ ( ( size_t ) 2, s . m_queries . size () );
+    REQUIRE_EQ ( string ( "ACGTACGT" ), s . m_queries [ 0 ] );
+    REQUIRE_EQ ( string ( "primer1" ), s . m_queryNames [ 0 ] );
+    REQUIRE_EQ ( string ( "TTTT" ), s . m_queries [ 1 ] );
+    REQUIRE_EQ ( string ( "primer2" ), s . m_queryNames [ 1 ] );
+}
+
+TEST_CASE ( LoadQueries_Lines )
+{
+    const string FileName = "queries.txt.tmp";
+    {
+        ofstream out ( FileName . c_str () );
+        out << "ACGT" << endl << endl << "TTTT" << endl;
+    }
+    VdbSearch :: Settings s;
+    REQUIRE ( s . LoadQueries ( FileName ) );
+    remove ( FileName . c_str () );
+    REQUIRE_EQ ( ( size_t ) 2, s . m_queries . size () );
+    REQUIRE_EQ ( string ( "TTTT" ), s . m_queries [ 1 ] );
+    REQUIRE_EQ ( string ( "TTTT" ), s . m_queryNames [ 1 ] );
+}
+
+TEST_CASE ( LoadQueries_NoFile )
+{
+    VdbSearch :: Settings s;
+    REQUIRE ( ! s . LoadQueries ( "does-not-exist" ) );
+}
+
+// ReportedFragments
+
+TEST_CASE ( ReportedFragments_Insert )
+{
+    ReferenceSearch :: ReportedFragments reported;
+    REQUIRE ( reported . Insert ( 1, 0 ) );
+    REQUIRE ( ! reported . Insert ( 1, 0 ) );
+    REQUIRE ( reported . Insert ( 1, 1 ) );
+    REQUIRE ( reported . Insert ( 2, 0 ) );
+    REQUIRE ( reported . Insert ( 1 << 20, 0 ) ); // another page
+    REQUIRE ( ! reported . Insert ( 1 << 20, 0 ) );
+    REQUIRE ( reported . Insert ( 1, 7 ) ); // more fragments than there are bits per row
+    REQUIRE ( ! reported . Insert ( 1, 7 ) );
+}
+
+// KmerIndex
+
+static const string IndexedQuery = "ACGTTGCAAGCTTGACCTGA"; // 20 bases
+
+static
+void
+AddTestBlobs ( KmerIndex & p_index )
+{
+    const string Filler ( 200, 'A' );
+    p_index . AddBlob ( 1, 10, ( Filler + IndexedQuery + Filler ) . c_str (), 2 * Filler . size () + IndexedQuery . size () );
+    p_index . AddBlob ( 11, 10, Filler . c_str (), Filler . size () );
+    const string Mutated = "ACGTTGCAAGCTTGtCCTGA";
+    p_index . AddBlob ( 21, 10, ( Filler + Mutated ) . c_str (), Filler . size () + Mutated . size () );
+}
+
+TEST_CASE ( KmerIndex_Exact )
+{
+    KmerIndex index;
+    AddTestBlobs ( index );
+    KmerIndex :: Seeds seeds ( vector < string > ( 1, IndexedQuery ), 100 );
+    REQUIRE ( seeds . IsSelective () );
+    REQUIRE ( index . MayContain ( 1, seeds ) );
+    REQUIRE ( ! index . MayContain ( 11, seeds ) );
+    REQUIRE ( ! index . MayContain ( 21, seeds ) );
+    REQUIRE ( index . MayContain ( 31, seeds ) ); // not in the index
+}
+
+TEST_CASE ( KmerIndex_Approximate )
+{   // 1 error: 2 pieces of 10 bases, too short to be seeds
+    KmerIndex :: Seeds seeds ( vector < string > ( 1, IndexedQuery ), 95 );
+    REQUIRE ( ! seeds . IsSelective () );
+    KmerIndex index;
+    AddTestBlobs ( index );
+    REQUIRE ( index . MayContain ( 11, seeds ) );
+
+    // 1 error: 2 pieces of 12 bases
+    const string Query = IndexedQuery + "ACGT";
+    KmerIndex :: Seeds seeds2 ( vector < string > ( 1, Query ), 95 );
+    REQUIRE ( seeds2 . IsSelective () );
+    REQUIRE ( index . MayContain ( 1, seeds2 ) );
+    REQUIRE ( ! index . MayContain ( 11, seeds2 ) );
+    REQUIRE ( index . MayContain ( 21, seeds2 ) ); // the first piece is there
+}
+
+TEST_CASE ( KmerIndex_CandidateRows )
+{
+    KmerIndex index;
+    AddTestBlobs ( index );
+    vector < string > queries;
+    queries . push_back ( IndexedQuery );
+    queries . push_back ( "ACGTTGCAAGCTTGtCCTGA" );
+    KmerIndex :: Seeds seeds ( queries, 100 );
+    KmerIndex :: RowRanges rows;
+    index . CandidateRows ( seeds, rows );
+    REQUIRE_EQ ( ( size_t ) 2, rows . size () );
+    REQUIRE_EQ ( ( int64_t ) 1, rows [ 0 ] . first );
+    REQUIRE_EQ ( ( uint64_t ) 10, rows [ 0 ] . second );
+    REQUIRE_EQ ( ( int64_t ) 21, rows [ 1 ] . first );
+
+    KmerIndex :: Seeds all ( vector < string > ( 1, "ACGT" ), 100 );
+    index . CandidateRows ( all, rows );
+    REQUIRE_EQ ( ( size_t ) 1, rows . size () );
+    REQUIRE_EQ ( ( uint64_t ) 30, rows [ 0 ] . second );
+}
+
+TEST_CASE ( KmerIndex_SaveLoad )
+{
+    const string FileName = KmerIndex :: FileName ( ".", "dir/SRR000001" );
+    REQUIRE_EQ ( string ( "./dir_SRR000001.kidx" ), FileName );
+    {
+        KmerIndex index;
+        AddTestBlobs ( index );
+        index . Save ( FileName );
+    }
+    KmerIndex index;
+    REQUIRE ( ! index . Load ( FileName, "SRR000002" ) );
+    REQUIRE ( index . Load ( FileName, "" ) ); // built without Build(), no accession name
+    remove ( FileName . c_str () );
+    REQUIRE_EQ ( ( size_t ) 3, index . BlobCount () );
+    KmerIndex :: Seeds seeds ( vector < string > ( 1, IndexedQuery ), 100 );
+    REQUIRE ( index . MayContain ( 1, seeds ) );
+    REQUIRE ( ! index . MayContain ( 11, seeds ) );
+    REQUIRE ( ! index . Load ( "does-not-exist", "" ) );
+}
+
+TEST_CASE ( KmerIndex_LoadUnordered )
+{   // MayContain() looks blobs up by binary search, an index with the blobs out of order is rejected
+    const string FileName = KmerIndex :: FileName ( ".", "unordered" );
+    {
+        KmerIndex index;
+        AddTestBlobs ( index );
+        index . Save ( FileName );
+    }
+    {   // the first row of the first blob follows the magic, 3 header words, the (empty) accession and the blob count
+        fstream file ( FileName . c_str (), ios :: in | ios :: out | ios :: binary );
+        const int64_t row = 100;
+        file . seekp ( 8 + 3 * 4 + 8 );
+        file . write ( ( const char * ) & row, sizeof ( row ) );
+    }
+    KmerIndex index;
+    REQUIRE ( ! index . Load ( FileName, "" ) );
+    remove ( FileName . c_str () );
+}
+
+FIXTURE_TEST_CASE ( KmerIndex_DirNotWritable, VdbSearchFixture )
+{   // the index cannot be saved, the search uses it anyway
+    const string Query = "ATTAGCATTAGCATTAGC";
+    const string Accession = "SRR600096";
+    vector < string > plain;
+    SetupSingleThread ( Query, VdbSearch :: FgrepDumb, Accession );
+    while ( NextMatch () )
+    {
+        plain . push_back ( m_result . m_fragmentId );
+    }
+
+    m_settings . m_accessions . clear ();
+    m_settings . m_indexDir = "./does-not-exist";
+    SetupSingleThread ( Query, VdbSearch :: FgrepDumb, Accession );
+    vector < string > indexed;
+    while ( NextMatch () )
+    {
+        indexed . push_back ( m_result . m_fragmentId );
+    }
+    REQUIRE ( plain == indexed );
+}
+
 FIXTURE_TEST_CASE ( SingleAccession_FirstMatches, VdbSearchFixture )
 {
     const string Accession = "SRR000001";
@@ -392,6 +574,59 @@ FIXTURE_TEST_CASE ( Threads_RandomCrash, VdbSearchFixture )
     REQUIRE_EQ ( 12u, count );
 }
 
+FIXTURE_TEST_CASE ( Threads_Ordered, VdbSearchFixture )
+{   // same output as from a single thread
+    m_settings . m_ordered = true;
+    m_settings . m_accessions . push_back ( "SRR600096" );
+    SetupMultiThread ( "ACGTAGG", VdbSearch :: FgrepDumb, 1, "SRR000001" );
+    vector < string > expected;
+    while ( NextMatch () )
+    {
+        expected . push_back ( m_result . m_fragmentId );
+    }
+    REQUIRE_LT ( ( size_t ) 1, expected . size () );
+
+    m_settings . m_accessions . pop_back ();
+    SetupMultiThread ( "ACGTAGG", VdbSearch :: FgrepDumb, 4, "SRR000001" );
+    for ( vector < string > :: const_iterator i = expected . begin (); i != expected . end (); ++i )
+    {
+        REQUIRE_EQ ( *i, NextFragmentId () );
+    }
+    REQUIRE ( ! NextMatch () );
+}
+
+FIXTURE_TEST_CASE ( Threads_ThreadPerAccession, VdbSearchFixture )
+{   // the threads start on different accessions; those done with their own take the blobs of the other one,
+    // every blob is searched exactly once
+    m_settings . m_accessions . push_back ( "SRR600096" );
+    SetupMultiThread ( "ACGTAGG", VdbSearch :: FgrepDumb, 1, "SRR000001" );
+    vector < string > expected;
+    while ( NextMatch () )
+    {
+        expected . push_back ( m_result . m_fragmentId );
+    }
+    REQUIRE_LT ( ( size_t ) 1, expected . size () );
+
+    m_settings . m_accessions . pop_back ();
+    m_settings . m_threadPerAcc = true;
+    SetupMultiThread ( "ACGTAGG", VdbSearch :: FgrepDumb, 4, "SRR000001" );
+    vector < string > actual;
+    while ( NextMatch () )
+    {
+        actual . push_back ( m_result . m_fragmentId );
+    }
+    sort ( expected . begin (), expected . end () );
+    sort ( actual . begin (), actual . end () );
+    REQUIRE ( expected == actual );
+}
+
+FIXTURE_TEST_CASE ( Threads_ThreadPerAccession_Ordered, VdbSearchFixture )
+{
+    m_settings . m_threadPerAcc = true;
+    m_settings . m_ordered = true;
+    REQUIRE_THROW ( SetupMultiThread ( "ACGTAGG", VdbSearch :: FgrepDumb, 4, "SRR000001" ) );
+}
+
 // Reference-driven mode
 
 FIXTURE_TEST_CASE ( ReferenceDriven_ReferenceNotFound, VdbSearchFixture )
@@ -632,6 +867,16 @@ FIXTURE_TEST_CASE ( Unaligned, VdbSearchFixture )
     //etc...
 }
 
+FIXTURE_TEST_CASE ( Unaligned_MultiThread, VdbSearchFixture )
+{
+    m_settings . m_unaligned  = true;
+    m_settings . m_ordered  = true;
+    SetupMultiThread ( "CACAG", VdbSearch :: FgrepDumb, 4, "SRR600099" );
+
+    REQUIRE_EQ ( string ( "SRR600099.FR0.1" ), NextFragmentId () );
+    REQUIRE_EQ ( string ( "SRR600099.FR1.438" ), NextFragmentId () );
+}
+
 #if WIN32
     #define main wmain
 #endif
@@ -27,14 +27,17 @@
 #include "vdb-search.hpp"
 
 #include <iostream>
+#include <fstream>
 #include <queue>
+#include <map>
 
-#include <atomic32.h>
-
-#include <klib/time.h>
+#include <klib/log.h>
 
 #include <kproc/thread.h>
 #include <kproc/lock.h>
+#include <kproc/cond.h>
+
+#include <atomic.h>
 
 #include <ngs/ErrorMsg.hpp>
 
@@ -51,101 +54,520 @@ bool VdbSearch :: logResults = false;
 
 class VdbSearch :: OutputQueue
 {   // thread safe output queue; one consumer, multiple producers
-    // counts producers
-    // if there are active producers, Pop will wait for new items to appear or the last producer to go away
+    // counts producers; producers push matches in batches to keep the lock traffic low. The batches belong to the queue:
+    // when Pop runs out of matches it takes over what the producers are holding, and until it returns a match the
+    // producers hand over every match at once, so that a sparse hit is not held back until its batch fills up
+    // if there are active producers, Pop will sleep until new items appear or the last producer goes away
+    //
+    // in ordered mode, every batch is tagged with its search and the iterator's number within the search, and Pop releases
+    // the matches in the order of the tags, as soon as all the preceding iterators are done. The memory held for reordering
+    // is bounded twice: the number of iterators taken but not released yet is limited by the window, see Reserve(), and
+    // a producer whose iterator is not the one being output waits once it has MaxChunkMatches matches queued, see Push().
+    // The latter matters when an iterator is big, e.g. a whole accession in fragment mode.
 public:
-    OutputQueue ( unsigned int p_producers )
+    struct Tag
     {
-        atomic32_set ( & m_producers, p_producers );
-        rc_t rc = KLockMake ( & m_outputQueueLock );
+        size_t m_search;
+        size_t m_iterator;
+
+        bool operator < ( const Tag & p_that ) const
+        {
+            return m_search < p_that . m_search || ( m_search == p_that . m_search && m_iterator < p_that . m_iterator );
+        }
+    };
+
+    class Batch
+    {   // matches of one producer not handed over yet, under m_lock; the lock order is the batch's m_lock, then the queue's
+        friend class OutputQueue;
+    public:
+        Batch () : m_lock ( 0 ) {}
+
+    private:
+        KLock *                             m_lock;
+        vector < SearchBuffer :: Match * >  m_matches;
+        Tag                                 m_tag;  // ordered mode
+    };
+
+public:
+    OutputQueue ( unsigned int p_producers, size_t p_searches = 0, size_t p_window = 0 ) // p_window == 0: unordered
+    :   m_lock ( 0 ),
+        m_cond ( 0 ),
+        m_roomCond ( 0 ),
+        m_producers ( p_producers ),
+        m_batches ( p_producers ),
+        m_attached ( 0 ),
+        m_ordered ( p_window != 0 ),
+        m_window ( p_window ),
+        m_open ( 0 ),
+        m_iteratorCounts ( p_searches, NotDone ),
+        m_quitting ( false )
+    {
+        m_next . m_search = 0;
+        m_next . m_iterator = 0;
+        atomic_set ( & m_starving, 0 );
+
+        rc_t rc = KLockMake ( & m_lock );
         if ( rc != 0 )
         {
             throw ( ErrorMsg ( "KLockMake failed" ) );
         }
+        rc = KConditionMake ( & m_cond );
+        if ( rc == 0 )
+        {
+            rc = KConditionMake ( & m_roomCond );
+            if ( rc != 0 )
+            {
+                KConditionRelease ( m_cond );
+            }
+        }
+        if ( rc != 0 )
+        {
+            KLockRelease ( m_lock );
+            throw ( ErrorMsg ( "KConditionMake failed" ) );
+        }
+        for ( size_t i = 0; i < m_batches . size (); ++i )
+        {
+            rc = KLockMake ( & m_batches [ i ] . m_lock );
+            if ( rc != 0 )
+            {
+                ReleaseBatches ();
+                KConditionRelease ( m_roomCond );
+                KConditionRelease ( m_cond );
+                KLockRelease ( m_lock );
+                throw ( ErrorMsg ( "KLockMake failed" ) );
+            }
+        }
     }
     ~OutputQueue()
     {
+        ReleaseBatches ();
         while ( m_queue . size () > 0 )
         {
             delete m_queue . front ();
             m_queue . pop ();
         }
+        for ( Chunks :: iterator i = m_chunks . begin (); i != m_chunks . end (); ++i )
+        {
+            while ( i -> second . m_matches . size () > 0 )
+            {
+                delete i -> second . m_matches . front ();
+                i -> second . m_matches . pop ();
+            }
+        }
+
+        KConditionRelease ( m_roomCond );
+        KConditionRelease ( m_cond );
+        KLockRelease ( m_lock );
+    }
+
+    bool IsOrdered () const { return m_ordered; }
 
-        KLockRelease ( m_outputQueueLock );
+    Batch & Attach () // called once by every producer
+    {
+        KLockAcquire ( m_lock );
+        assert ( m_attached < m_batches . size () );
+        Batch & ret = m_batches [ m_attached ++ ];
+        KLockUnlock ( m_lock );
+        return ret;
     }
 
     void ProducerDone () // called by the producers
     {
-        assert ( atomic32_read ( & m_producers ) > 0 );
-        atomic32_dec ( & m_producers );
+        KLockAcquire ( m_lock );
+        assert ( m_producers > 0 );
+        -- m_producers;
+        if ( m_producers == 0 )
+        {
+            KConditionSignal ( m_cond );
+        }
+        KLockUnlock ( m_lock );
+    }
+
+    void Quit () // wakes up the producers waiting in Reserve() and Push()
+    {
+        KLockAcquire ( m_lock );
+        m_quitting = true;
+        KConditionBroadcast ( m_roomCond );
+        KLockUnlock ( m_lock );
+    }
+
+    // called by the producers; hands the batch over once it is full or if the consumer is waiting
+    // in ordered mode, may block until the consumer gets to the producer's iterator
+    void Push ( Batch & p_batch, SearchBuffer :: Match * p_match )
+    {
+        KLockAcquire ( p_batch . m_lock );
+        p_batch . m_matches . push_back ( p_match );
+        // m_starving is read without the queue's lock; see Pop() for why a match cannot be left behind
+        const bool handOver = p_batch . m_matches . size () >= BatchSize || atomic_read ( & m_starving ) != 0;
+        if ( handOver )
+        {
+            HandOver ( p_batch, false );
+        }
+        KLockUnlock ( p_batch . m_lock );
+
+        if ( handOver && m_ordered )
+        {   // not under the batch's lock, the consumer may need it to collect the batches
+            WaitForOutput ( p_batch . m_tag );
+        }
+    }
+
+    // called by the producers when done with an iterator; p_done (ordered mode): the iterator has no more matches
+    void Flush ( Batch & p_batch, bool p_done )
+    {
+        KLockAcquire ( p_batch . m_lock );
+        HandOver ( p_batch, p_done );
+        KLockUnlock ( p_batch . m_lock );
+    }
+
+    // ordered mode, called by the producers
+
+    // before taking an iterator; blocks while the window is full; false if quitting
+    bool Reserve ()
+    {
+        KLockAcquire ( m_lock );
+        while ( m_open >= m_window && ! m_quitting )
+        {
+            KConditionWait ( m_roomCond, m_lock );
+        }
+        const bool ret = ! m_quitting;
+        if ( ret )
+        {
+            ++ m_open;
+        }
+        KLockUnlock ( m_lock );
+        return ret;
+    }
+
+    // no iterator was taken after Reserve()
+    void Unreserve ()
+    {
+        KLockAcquire ( m_lock );
+        assert ( m_open > 0 );
+        -- m_open;
+        KConditionBroadcast ( m_roomCond );
+        KLockUnlock ( m_lock );
+    }
+
+    // after taking an iterator; the batch has been flushed
+    void Begin ( Batch & p_batch, const Tag & p_tag )
+    {
+        KLockAcquire ( p_batch . m_lock );
+        assert ( p_batch . m_matches . empty () );
+        p_batch . m_tag = p_tag;
+        KLockUnlock ( p_batch . m_lock );
     }
 
-    void Push ( SearchBuffer :: Match * p_match ) // called by the producers
+    // the search will not return more iterators
+    void SearchDone ( size_t p_search, size_t p_iterators )
     {
-        KLockAcquire ( m_outputQueueLock );
-        m_queue . push ( p_match );
-        KLockUnlock ( m_outputQueueLock );
+        KLockAcquire ( m_lock );
+        m_iteratorCounts [ p_search ] = p_iterators;
+        KConditionSignal ( m_cond );
+        KLockUnlock ( m_lock );
     }
 
     // called by the consumer; will block until items become available or the last producer goes away
     SearchBuffer :: Match * Pop ()
     {
-        while ( m_queue . size () == 0 && atomic32_read ( & m_producers ) > 0 )
+        KLockAcquire ( m_lock );
+        SearchBuffer :: Match * ret = 0;
+        bool collected = false;
+        while ( true )
+        {
+            if ( m_ordered )
+            {
+                ret = NextInOrder ();
+            }
+            else if ( m_queue . size () > 0 )
+            {
+                ret = m_queue . front ();
+                m_queue . pop ();
+            }
+
+            if ( ret != 0 || m_producers == 0 || ( m_ordered && m_next . m_search == m_iteratorCounts . size () ) )
+            {
+                break;
+            }
+            if ( ! collected )
+            {   // m_starving is set before the batches are collected: a producer that adds to its batch after the
+                // collection has passed it acquires the batch lock after us, sees the flag and hands the match over
+                atomic_set ( & m_starving, 1 );
+                KLockUnlock ( m_lock );
+                for ( size_t i = 0; i < m_batches . size (); ++i )
+                {
+                    KLockAcquire ( m_batches [ i ] . m_lock );
+                    HandOver ( m_batches [ i ], false );
+                    KLockUnlock ( m_batches [ i ] . m_lock );
+                }
+                KLockAcquire ( m_lock );
+                collected = true;
+                continue;
+            }
+            KConditionWait ( m_cond, m_lock );
+        }
+        atomic_set ( & m_starving, 0 );
+        KLockUnlock ( m_lock );
+        return ret;
+    }
+
+private:
+    static const size_t NotDone = ( size_t ) -1;
+    // matches handed over to the queue at once while the consumer is busy
+    static const size_t BatchSize = 16;
+    // ordered mode: matches queued for an iterator that is not being output yet
+    static const size_t MaxChunkMatches = 4096;
+
+    struct Chunk
+    {
+        Chunk () : m_done ( false ) {}
+
+        queue < SearchBuffer :: Match * >   m_matches;
+        bool                                m_done;
+    };
+    typedef map < Tag, Chunk > Chunks;
+
+    // under the batch's lock; moves the batch's matches to the queue, or to the batch's chunk in ordered mode
+    void HandOver ( Batch & p_batch, bool p_done )
+    {
+        if ( p_batch . m_matches . empty () && ! p_done )
+        {
+            return;
+        }
+
+        KLockAcquire ( m_lock );
+        if ( m_ordered )
+        {
+            Chunk & chunk = m_chunks [ p_batch . m_tag ];
+            for ( size_t i = 0; i < p_batch . m_matches . size (); ++i )
+            {
+                chunk . m_matches . push ( p_batch . m_matches [ i ] );
+            }
+            if ( p_done )
+            {
+                chunk . m_done = true;
+            }
+            if ( ! ( p_batch . m_tag < m_next ) && ! ( m_next < p_batch . m_tag ) )
+            {   // only the next chunk in order can wake up the consumer
+                KConditionSignal ( m_cond );
+            }
+        }
+        else if ( ! p_batch . m_matches . empty () )
         {
-            KSleepMs(1);
+            for ( size_t i = 0; i < p_batch . m_matches . size (); ++i )
+            {
+                m_queue . push ( p_batch . m_matches [ i ] );
+            }
+            KConditionSignal ( m_cond );
         }
+        KLockUnlock ( m_lock );
 
-        assert ( m_queue . size () > 0 || atomic32_read ( & m_producers ) == 0 );
+        p_batch . m_matches . clear ();
+    }
 
-        if ( m_queue . size () > 0 )
+    // ordered mode, called by the producers; blocks while the iterator's chunk is full and the consumer is busy with
+    // the ones before it. The iterator being output is never blocked, so the consumer always gets to the waiting ones
+    void WaitForOutput ( const Tag & p_tag )
+    {
+        KLockAcquire ( m_lock );
+        while ( ! m_quitting && m_next < p_tag && m_chunks [ p_tag ] . m_matches . size () >= MaxChunkMatches )
         {
-            KLockAcquire ( m_outputQueueLock );
-            SearchBuffer :: Match * ret = m_queue . front ();
-            m_queue.pop();
-            KLockUnlock ( m_outputQueueLock );
-            return ret;
+            KConditionWait ( m_roomCond, m_lock );
         }
+        KLockUnlock ( m_lock );
+    }
 
-        assert ( atomic32_read ( & m_producers ) == 0 );
+    void ReleaseBatches ()
+    {
+        for ( size_t i = 0; i < m_batches . size (); ++i )
+        {
+            for ( size_t j = 0; j < m_batches [ i ] . m_matches . size (); ++j )
+            {
+                delete m_batches [ i ] . m_matches [ j ];
+            }
+            KLockRelease ( m_batches [ i ] . m_lock );
+        }
+    }
+
+    // under m_lock; the next match in order if already there, moving past the finished iterators and searches
+    SearchBuffer :: Match * NextInOrder ()
+    {
+        while ( m_next . m_search < m_iteratorCounts . size () )
+        {
+            Chunks :: iterator chunk = m_chunks . find ( m_next );
+            if ( chunk != m_chunks . end () )
+            {
+                if ( chunk -> second . m_matches . size () > 0 )
+                {
+                    SearchBuffer :: Match * ret = chunk -> second . m_matches . front ();
+                    chunk -> second . m_matches . pop ();
+                    return ret;
+                }
+                if ( ! chunk -> second . m_done )
+                {
+                    return 0;
+                }
+                m_chunks . erase ( chunk );
+                ++ m_next . m_iterator;
+                assert ( m_open > 0 );
+                -- m_open;
+                // wakes up the producers waiting for room in the window and the one that may now be the next to output
+                KConditionBroadcast ( m_roomCond );
+            }
+            else if ( m_next . m_iterator == m_iteratorCounts [ m_next . m_search ] )
+            {
+                ++ m_next . m_search;
+                m_next . m_iterator = 0;
+                KConditionBroadcast ( m_roomCond );
+            }
+            else
+            {
+                return 0;
+            }
+        }
         return 0;
     }
 
-private:
     queue < SearchBuffer :: Match * > m_queue;
 
-    KLock* m_outputQueueLock;
+    KLock*          m_lock;
+    KCondition*     m_cond;     // signaled on new items and when the last producer is done
+    KCondition*     m_roomCond; // broadcast when the window has room or the next iterator changes (ordered mode)
+
+    unsigned int    m_producers;
 
-    atomic32_t m_producers;
+    vector < Batch >    m_batches;      // one per producer
+    size_t              m_attached;
+    atomic_t            m_starving;     // the consumer has run out of matches; set by Pop(), read by Push() without m_lock
+
+    // ordered mode
+    bool                m_ordered;
+    size_t              m_window;
+    size_t              m_open;             // iterators reserved and not released yet
+    Chunks              m_chunks;
+    Tag                 m_next;             // the iterator to release matches from
+    vector < size_t >   m_iteratorCounts;   // per search, NotDone until the search is exhausted
+    bool                m_quitting;
 };
 
+const size_t VdbSearch :: OutputQueue :: NotDone;
+const size_t VdbSearch :: OutputQueue :: BatchSize;
+const size_t VdbSearch :: OutputQueue :: MaxChunkMatches;
+
 ////////////////////  VdbSearch :: SearchThreadBlock
 
 struct VdbSearch :: SearchThreadBlock
-{
+{   // every search (accession) has its own lock, so that threads working on different accessions do not wait for each other
+    // a thread takes iterators from its home search and, once that is exhausted, steals them from the others;
+    // all threads start on the first search, or, in thread-per-accession mode, on different searches
+    struct Slot
+    {
+        ThreadableSearch *  m_search;
+        KLock *             m_lock;
+        bool                m_exhausted; // under m_lock
+        size_t              m_taken;     // under m_lock, iterators returned so far
+    };
+
     VdbSearch :: OutputQueue& m_output;
 
-    VdbSearch :: SearchQueue &                  m_search;
-    KLock *                                     m_searchQueueLock;
-    VdbSearch :: SearchQueue :: const_iterator  m_nextSearch;
+    std :: vector < Slot >  m_slots;
+    KLock *                 m_homeLock;
+    size_t                  m_nextHome;     // under m_homeLock
+    bool                    m_spreadHomes;
 
     bool m_quitting;
 
-    SearchThreadBlock ( SearchQueue& p_search, OutputQueue& p_output )
+    SearchThreadBlock ( SearchQueue& p_search, OutputQueue& p_output, bool p_spreadHomes )
     :   m_output ( p_output ),
-        m_search ( p_search ),
-        m_searchQueueLock ( 0 ),
-        m_nextSearch ( m_search . begin () ),
+        m_homeLock ( 0 ),
+        m_nextHome ( 0 ),
+        m_spreadHomes ( p_spreadHomes ),
         m_quitting ( false )
     {
-        rc_t rc = KLockMake ( & m_searchQueueLock );
+        rc_t rc = KLockMake ( & m_homeLock );
         if ( rc != 0 )
         {
             throw ( ErrorMsg ( "KLockMake failed" ) );
         }
+        for ( SearchQueue :: const_iterator i = p_search . begin (); i != p_search . end (); ++i )
+        {
+            Slot slot;
+            slot . m_search = *i;
+            slot . m_exhausted = false;
+            slot . m_taken = 0;
+            rc = KLockMake ( & slot . m_lock );
+            if ( rc != 0 )
+            {
+                ReleaseLocks ();
+                throw ( ErrorMsg ( "KLockMake failed" ) );
+            }
+            m_slots . push_back ( slot );
+        }
     }
     ~SearchThreadBlock ()
     {
-        KLockRelease ( m_searchQueueLock );
+        ReleaseLocks ();
+    }
+
+    size_t NextHome ()
+    {
+        KLockAcquire ( m_homeLock );
+        const size_t ret = m_spreadHomes && ! m_slots . empty () ? m_nextHome ++ % m_slots . size () : 0;
+        KLockUnlock ( m_homeLock );
+        return ret;
+    }
+
+    // the next iterator of the first search that has one, starting from p_home; 0 if all searches are exhausted
+    // p_tag identifies the iterator for the ordered output
+    MatchIterator * NextIterator ( size_t p_home, OutputQueue :: Tag & p_tag )
+    {
+        for ( size_t i = 0; i < m_slots . size () && ! m_quitting; ++i )
+        {
+            const size_t index = ( p_home + i ) % m_slots . size ();
+            Slot & slot = m_slots [ index ];
+            MatchIterator * ret = 0;
+            KLockAcquire ( slot . m_lock );
+            try
+            {
+                if ( ! slot . m_exhausted )
+                {
+                    ret = slot . m_search -> NextIterator ();
+                    if ( ret != 0 )
+                    {
+                        p_tag . m_search = index;
+                        p_tag . m_iterator = slot . m_taken ++;
+                    }
+                    else
+                    {
+                        slot . m_exhausted = true;
+                        if ( m_output . IsOrdered () )
+                        {
+                            m_output . SearchDone ( index, slot . m_taken );
+                        }
+                    }
+                }
+            }
+            catch ( ... )
+            {
+                KLockUnlock ( slot . m_lock );
+                throw;
+            }
+            KLockUnlock ( slot . m_lock );
+            if ( ret != 0 )
+            {
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+private:
+    void ReleaseLocks ()
+    {
+        for ( std :: vector < Slot > :: iterator i = m_slots . begin (); i != m_slots . end (); ++i )
+        {
+            KLockRelease ( i -> m_lock );
+        }
+        KLockRelease ( m_homeLock );
     }
 };
 
@@ -167,6 +589,7 @@ struct {
     ALG ( AgrepMyersUnltd ),
     ALG ( NucStrstr ),
     ALG ( SmithWaterman ),
+    ALG ( MyersBitParallel ),
 #undef ALG
 };
 
@@ -181,7 +604,8 @@ VdbSearch :: Settings :: Settings ()
     m_maxMatches ( 0 ),
     m_unaligned ( false ),
     m_fasta ( false ),
-    m_fastaLineLength ( 70 )
+    m_fastaLineLength ( 70 ),
+    m_ordered ( false )
 {
 }
 
@@ -199,6 +623,58 @@ VdbSearch :: Settings :: SetAlgorithm ( const std :: string& p_algStr )
     return false;
 }
 
+bool
+VdbSearch :: Settings :: LoadQueries ( const std :: string& p_filename )
+{
+    ifstream in ( p_filename . c_str () );
+    if ( ! in )
+    {
+        return false;
+    }
+
+    m_queries . clear ();
+    m_queryNames . clear ();
+
+    string line;
+    bool fasta = false;
+    while ( getline ( in, line ) )
+    {
+        if ( ! line . empty () && line [ line . size () - 1 ] == '\r' )
+        {
+            line . erase ( line . size () - 1 );
+        }
+        if ( line . empty () )
+        {
+            continue;
+        }
+
+        if ( line [ 0 ] == '>' )
+        {   // a new query, named by the first word of the defline
+            fasta = true;
+            m_queryNames . push_back ( line . substr ( 1, line . find_first_of ( " \t" ) - 1 ) );
+            m_queries . push_back ( string () );
+        }
+        else if ( fasta )
+        {
+            m_queries . back () += line;
+        }
+        else
+        {
+            m_queryNames . push_back ( line );
+            m_queries . push_back ( line );
+        }
+    }
+
+    for ( vector < string > :: const_iterator i = m_queries . begin (); i != m_queries . end (); ++i )
+    {
+        if ( i -> empty () )
+        {
+            return false;
+        }
+    }
+    return ! m_queries . empty ();
+}
+
 //////////////////// VdbSearch
 
 static
@@ -209,6 +685,33 @@ CheckArguments ( const VdbSearch :: Settings& p_settings )
     {
         throw invalid_argument ( "query expressions are only supported for NucStrstr" );
     }
+    if ( ! p_settings . m_queries . empty () )
+    {
+        switch ( p_settings . m_algorithm )
+        {
+            case VdbSearch :: NucStrstr:
+            case VdbSearch :: SmithWaterman:
+            case VdbSearch :: MyersBitParallel:
+                throw invalid_argument ( "multiple queries are only supported for Fgrep and Agrep" );
+            default:
+                break;
+        }
+        if ( p_settings . m_referenceDriven )
+        {
+            throw invalid_argument ( "multiple queries are not supported in reference mode" );
+        }
+    }
+    if ( p_settings . m_threadPerAcc && p_settings . m_ordered )
+    {   // ordered output takes the iterators in the order of the output, from the first search that has them
+        throw invalid_argument ( "thread-per-accession mode is not supported with ordered output" );
+    }
+    if ( ! p_settings . m_indexDir . empty () )
+    {
+        if ( p_settings . m_referenceDriven || p_settings . m_isExpression || p_settings . m_algorithm == VdbSearch :: SmithWaterman )
+        {
+            throw invalid_argument ( "k-mer indexes are not supported with reference mode, expressions or SmithWaterman" );
+        }
+    }
     if ( p_settings . m_minScorePct != 100 )
     {
         switch ( p_settings . m_algorithm )
@@ -229,6 +732,7 @@ VdbSearch :: VdbSearch ( const Settings& p_settings )
 :   m_settings ( p_settings ),
     m_sbFactory ( m_settings ),
     m_buf ( 0 ),
+    m_seeds ( 0 ),
     m_output ( 0 ),
     m_searchBlock ( 0 ),
     m_matchCount ( 0 )
@@ -238,22 +742,53 @@ VdbSearch :: VdbSearch ( const Settings& p_settings )
         m_settings . m_useBlobSearch = false; // SW takes too long on big buffers
     }
     if ( m_settings . m_unaligned )
-    {   // unaligned goes by fragments, single threaded
+    {   // unaligned goes by fragments, in ranges of rows
         m_settings . m_useBlobSearch = false;
-        m_settings . m_threads = 1;
     }
 
     CheckArguments ( m_settings );
 
+    if ( ! m_settings . m_indexDir . empty () )
+    {
+        m_seeds = new KmerIndex :: Seeds ( m_settings . m_queries . empty () ? vector < string > ( 1, m_settings . m_query ) : m_settings . m_queries,
+                                           m_settings . m_minScorePct );
+    }
+
     for ( vector<string>::const_iterator i = m_settings . m_accessions . begin(); i != m_settings . m_accessions . end(); ++i )
     {
+        const KmerIndex * index = 0;
+        if ( m_seeds != 0 && m_seeds -> IsSelective () )
+        {   // built on the first search of the accession, reused by the following ones
+            m_indexes . push_back ( new KmerIndex () );
+            const string indexFile = KmerIndex :: FileName ( m_settings . m_indexDir, *i );
+            if ( ! m_indexes . back () -> Load ( indexFile, *i ) )
+            {
+                m_indexes . back () -> Build ( *i );
+                try
+                {
+                    m_indexes . back () -> Save ( indexFile );
+                }
+                catch ( const ErrorMsg & x )
+                {   // still good for this search
+                    PLOGMSG ( klogWarn, ( klogWarn, "$(e); the k-mer index of $(a) is used without saving it", "e=%s,a=%s", x . what (), i -> c_str () ) );
+                }
+            }
+            index = m_indexes . back ();
+        }
+
         if ( m_settings . m_referenceDriven )
         {
             m_searches . push_back ( new ReferenceSearch ( m_sbFactory, *i, m_settings . m_references, m_settings . m_useBlobSearch ) );
         }
         else if ( m_settings . m_useBlobSearch )
         {
-            m_searches . push_back ( new BlobSearch ( m_sbFactory, *i ) );
+            m_searches . push_back ( new BlobSearch ( m_sbFactory, *i, index, index != 0 ? m_seeds : 0 ) );
+        }
+        else if ( index != 0 )
+        {
+            KmerIndex :: RowRanges rows;
+            index -> CandidateRows ( * m_seeds, rows );
+            m_searches . push_back ( new FragmentSearch ( m_sbFactory, *i, m_settings . m_unaligned, & rows ) );
         }
         else
         {
@@ -268,6 +803,7 @@ VdbSearch :: ~VdbSearch ()
     if ( m_searchBlock != 0 )
     {
         m_searchBlock -> m_quitting = true;
+        m_output -> Quit ();
         for ( ThreadPool :: iterator i = m_threadPool . begin (); i != m_threadPool. end (); ++i )
         {
             //KThreadCancel ( *i ); does not work too well, instead using m_searchBlock -> m_quitting to command threads to exit orderly
@@ -283,6 +819,12 @@ VdbSearch :: ~VdbSearch ()
     }
     m_searches . clear ();
 
+    for ( vector < KmerIndex* > :: iterator i = m_indexes . begin (); i != m_indexes . end (); ++i )
+    {
+        delete * i;
+    }
+    delete m_seeds;
+
     delete m_buf;
     delete m_output;
 }
@@ -298,34 +840,37 @@ VdbSearch :: GetSupportedAlgorithms ()
     return ret;
 }
 
+// ordered output: iterators (blobs) per thread taken ahead of the one being output
+static const size_t OrderWindowPerThread = 4;
+
 rc_t CC VdbSearch :: ThreadPerIterator ( const KThread *self, void *data )
 {
     assert ( data );
     SearchThreadBlock& sb = * reinterpret_cast < SearchThreadBlock* > ( data );
-    assert ( sb . m_searchQueueLock );
+    const size_t home = sb . NextHome ();
+    const bool ordered = sb . m_output . IsOrdered ();
+    OutputQueue :: Batch & batch = sb . m_output . Attach ();
+    OutputQueue :: Tag tag;
     // cout << "Thread " << (void*)self << " started " << endl;
     while ( ! sb . m_quitting )
     {
-        KLockAcquire ( sb . m_searchQueueLock );
-        MatchIterator* it = 0;
-        while ( ! sb . m_quitting && sb . m_nextSearch != sb . m_search . end () )
+        if ( ordered && ! sb . m_output . Reserve () )
         {
-            it = ( * sb . m_nextSearch ) -> NextIterator ();
-            if ( it == 0 )
-            {
-                ++ sb . m_nextSearch;
-            }
-            else
-            {
-                break;
-            }
+            break;
         }
-        KLockUnlock ( sb . m_searchQueueLock );
-
+        MatchIterator* it = sb . NextIterator ( home, tag );
         if ( it == 0 )
         {
+            if ( ordered )
+            {
+                sb . m_output . Unreserve ();
+            }
             break;
         }
+        if ( ordered )
+        {
+            sb . m_output . Begin ( batch, tag );
+        }
 
         // cout << "Thread " << (void*)self << " next iterator " << endl;
         while ( ! sb . m_quitting )
@@ -336,8 +881,10 @@ rc_t CC VdbSearch :: ThreadPerIterator ( const KThread *self, void *data )
                 break;
             }
             // cout << "Thread " << (void*)self << " next match " << endl;
-            sb . m_output . Push ( m );
+            sb . m_output . Push ( batch, m );
         }
+        // do not hold on to the matches while looking for the next iterator
+        sb . m_output . Flush ( batch, ! sb . m_quitting );
         delete it;
     }
     // cout << "Thread " << (void*)self << " finished " << endl;
@@ -348,23 +895,39 @@ rc_t CC VdbSearch :: ThreadPerIterator ( const KThread *self, void *data )
 
 void
 VdbSearch :: FormatMatch ( const SearchBuffer :: Match & p_source, Match & p_result )
-{
-    p_result . m_fragmentId = p_source . m_fragmentId;
-    if ( m_settings . m_fasta )
+{   // the strings of p_result are overwritten in place, so a Match reused by the caller does not reallocate them
+    p_result . m_fragmentId . assign ( p_source . m_fragmentId );
+    if ( ! m_settings . m_queries . empty () )
     {
-        p_result . m_formatted = string ( ">" ) + p_result . m_fragmentId + "\n";
+        p_result . m_queryName . assign ( m_settings . m_queryNames [ p_source . m_queryIndex ] );
+    }
 
-        size_t start = 0;
+    string & out = p_result . m_formatted;
+    if ( m_settings . m_fasta )
+    {
         const size_t totalBases = p_source . m_bases . length ();
-        while ( start < totalBases )
+        const size_t lineLength = m_settings . m_fastaLineLength;
+        out . clear ();
+        out . reserve ( p_result . m_fragmentId . size () + p_result . m_queryName . size () + 3 + totalBases + totalBases / lineLength + 1 );
+        out . append ( 1, '>' ) . append ( p_result . m_fragmentId );
+        if ( ! p_result . m_queryName . empty () )
+        {
+            out . append ( 1, ' ' ) . append ( p_result . m_queryName );
+        }
+        out . append ( 1, '\n' );
+
+        for ( size_t start = 0; start < totalBases; start += lineLength )
         {
-            p_result . m_formatted += p_source . m_bases . substr ( start, m_settings . m_fastaLineLength ) + "\n";
-            start += m_settings . m_fastaLineLength;
+            out . append ( p_source . m_bases, start, lineLength ) . append ( 1, '\n' );
         }
     }
     else
     {   // by default, simply the Id of the fragment
-        p_result . m_formatted = p_source . m_fragmentId;
+        out . assign ( p_source . m_fragmentId );
+        if ( ! p_result . m_queryName . empty () )
+        {
+            out . append ( 1, '\t' ) . append ( p_result . m_queryName );
+        }
     }
 }
 
@@ -380,13 +943,21 @@ VdbSearch :: NextMatch ( Match & p_match )
     {
         size_t threadNum = m_settings . m_threads;
 
-        if ( ! m_settings . m_useBlobSearch && threadNum > m_searches . size () )
-        {   // in thread-per-accession mode, no need for more threads than there are accessions
+        if ( ! m_settings . m_useBlobSearch && ! m_settings . m_unaligned && m_indexes . empty () && threadNum > m_searches . size () )
+        {   // a fragment search of the whole accession is 1 iterator, no need for more threads than there are accessions
             threadNum = m_searches . size ();
         }
 
-        m_output = new OutputQueue ( threadNum );
-        m_searchBlock = new SearchThreadBlock ( m_searches, *m_output );
+        if ( m_settings . m_ordered )
+        {   // iterators are taken in the output order, from the first search that has them
+            m_output = new OutputQueue ( threadNum, m_searches . size (), threadNum * OrderWindowPerThread );
+            m_searchBlock = new SearchThreadBlock ( m_searches, *m_output, false );
+        }
+        else
+        {
+            m_output = new OutputQueue ( threadNum );
+            m_searchBlock = new SearchThreadBlock ( m_searches, *m_output, m_settings . m_threadPerAcc );
+        }
         for ( unsigned  int i = 0 ; i != threadNum; ++i )
         {
             KThread* t;
@@ -421,6 +992,31 @@ VdbSearch :: SearchBlockFactory :: SearchBlockFactory ( const VdbSearch :: Setti
 SearchBlock*
 VdbSearch :: SearchBlockFactory :: MakeSearchBlock () const
 {
+    if ( ! m_settings . m_queries . empty () )
+    {   // one pass for all queries
+        switch ( m_settings . m_algorithm )
+        {
+            case VdbSearch :: FgrepDumb:
+                return new FgrepSearch ( m_settings . m_queries, FgrepSearch :: FgrepDumb );
+            case VdbSearch :: FgrepBoyerMoore:
+                return new FgrepSearch ( m_settings . m_queries, FgrepSearch :: FgrepBoyerMoore );
+            case VdbSearch :: FgrepAho:
+                return new FgrepSearch ( m_settings . m_queries, FgrepSearch :: FgrepAho );
+
+            case VdbSearch :: AgrepDP:
+                return new MultiAgrepSearch ( m_settings . m_queries, AgrepSearch :: AgrepDP, m_settings . m_minScorePct );
+            case VdbSearch :: AgrepWuManber:
+                return new MultiAgrepSearch ( m_settings . m_queries, AgrepSearch :: AgrepWuManber, m_settings . m_minScorePct );
+            case VdbSearch :: AgrepMyers:
+                return new MultiAgrepSearch ( m_settings . m_queries, AgrepSearch :: AgrepMyers, m_settings . m_minScorePct );
+            case VdbSearch :: AgrepMyersUnltd:
+                return new MultiAgrepSearch ( m_settings . m_queries, AgrepSearch :: AgrepMyersUnltd, m_settings . m_minScorePct );
+
+            default:
+                throw ( ErrorMsg ( "SearchBlockFactory: unsupported algorithm for multiple queries" ) );
+        }
+    }
+
     switch ( m_settings . m_algorithm )
     {
         case VdbSearch :: FgrepDumb:
@@ -445,6 +1041,9 @@ VdbSearch :: SearchBlockFactory :: MakeSearchBlock () const
         case VdbSearch :: SmithWaterman:
             return new SmithWatermanSearch ( m_settings . m_query, m_settings . m_minScorePct );
 
+        case VdbSearch :: MyersBitParallel:
+            return new MyersSearch ( m_settings . m_query, m_settings . m_minScorePct );
+
         default:
             throw ( ErrorMsg ( "SearchBlockFactory: unsupported algorithm" ) );
     }
@@ -36,6 +36,7 @@
 #include "searchbuffer.hpp"
 #include "referencespec.hpp"
 #include "threadablesearch.hpp"
+#include "kmerindex.hpp"
 
 struct KThread;
 class MatchIterator;
@@ -59,6 +60,7 @@ public:
         AgrepMyersUnltd,
         NucStrstr,
         SmithWaterman,
+        MyersBitParallel,
     } Algorithm;
 
     typedef std :: vector < std :: string >  SupportedAlgorithms;
@@ -72,6 +74,8 @@ public:
     {
         Algorithm                   m_algorithm;    // default FgrepDumb
         std::string                 m_query;
+        std::vector < std::string > m_queries;          // default empty; if not, searched for all at once instead of m_query
+        std::vector < std::string > m_queryNames;       // same size as m_queries, reported with matches
         std::vector < std::string > m_accessions;
         bool                        m_isExpression;     // default false
         unsigned int                m_minScorePct;      // default 100
@@ -84,14 +88,19 @@ public:
         bool                        m_unaligned;        // default false
         bool                        m_fasta;            // default false
         unsigned int                m_fastaLineLength;  // default 70
+        std::string                 m_indexDir;         // default empty (no k-mer indexes); see KmerIndex
+        bool                        m_ordered;          // default false; if true, the output does not depend on the threads
 
         Settings ();
         bool SetAlgorithm ( const std :: string& algorithm );
+        // FASTA (named by the deflines) or one query per line (named by the query itself); false if no queries could be read
+        bool LoadQueries ( const std :: string& filename );
     };
 
     struct Match
     {
         std :: string   m_fragmentId;
+        std :: string   m_queryName; // multiple queries only
         std :: string   m_formatted; // the contents are controlled by settings: a copy of m_fragmentId, or text in fasta, etc
     };
 
@@ -135,6 +144,10 @@ private:
 
     SearchQueue     m_searches;
 
+    // used with m_settings . m_indexDir
+    std :: vector < KmerIndex* >    m_indexes;
+    KmerIndex :: Seeds*             m_seeds;
+
     // used with multi-threading
     OutputQueue*                m_output;
     struct SearchThreadBlock*   m_searchBlock;
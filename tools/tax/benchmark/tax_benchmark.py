@@ -0,0 +1,324 @@
+#!/usr/bin/env python
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+# benchmark of the tax pipeline on synthetic data, no SRA access needed
+#
+# for every dataset size generates (once, cached in --work-dir) a sequence tree,
+# tax.parents and a read set, builds -db/-dbs/-dbss databases with build_index,
+# db_fasta_to_bin and sort_dbs, then runs aligns_to, build_index, get_profile and
+# contig_builder (as is and with -bloom_filter_mb) for every thread count
+#
+# load_sec is the time before any input is processed: for aligns_to it comes from its metrics,
+# for the other tools from a run of the same command on a tiny input (one short read or genome)
+#
+# report is json lines, one record per run:
+# size, tool, mode, threads, wall_sec, load_sec, reads_per_sec, kmers_per_sec, peak_rss_mb, ...
+
+from __future__ import print_function
+
+import os
+import sys
+import json
+import time
+import random
+import logging
+import argparse
+import platform
+import subprocess
+
+logger = logging.getLogger('tax_benchmark')
+
+KMER_LEN = 32
+READ_LEN = 150
+WINDOW_DIVIDER = 1000
+GET_PROFILE_MIN_HASH_COUNT = 2
+CONTIG_BUILDER_BLOOM_FILTER_MB_PER_100K_READS = 16 # about 24 bits per distinct kmer of the synthetic reads
+
+# name: (families, species per family, genome length, reads, min window size)
+# build_index keeps about one kmer per min window size bases of the genomes (virus windows are always the minimum),
+# so small to large have 15K to 1.5M db kmers, large_db keeps nearly every kmer: ~40M, a few hundred MB of db,
+# enough for db loading and lookups to cost what they cost on real dbs
+SIZES = {
+    'small': (4, 5, 50000, 100000, 64),
+    'medium': (10, 10, 200000, 1000000, 64),
+    'large': (20, 20, 500000, 5000000, 64),
+    'large_db': (20, 20, 500000, 1000000, 4),
+}
+
+COMPLEMENT = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A'}
+
+def random_seq(rnd, length):
+    return ''.join(rnd.choice('ACGT') for _ in range(length))
+
+def mutate(rnd, seq, rate):
+    seq = list(seq)
+    for _ in range(int(len(seq) * rate)):
+        pos = rnd.randrange(len(seq))
+        seq[pos] = rnd.choice('ACGT'.replace(seq[pos], ''))
+    return ''.join(seq)
+
+def reverse_complement(seq):
+    return ''.join(COMPLEMENT[c] for c in reversed(seq))
+
+def write_fasta(f, defline, seq, line_len=70):
+    f.write('>' + defline + '\n')
+    for i in range(0, len(seq), line_len):
+        f.write(seq[i:i + line_len] + '\n')
+
+class Dataset(object):
+    def __init__(self, work_dir, size, seed):
+        self.size = size
+        self.dir = os.path.join(work_dir, size)
+        self.families, self.species_per_family, self.genome_len, self.read_count, self.min_window_size = SIZES[size]
+        self.seed = seed
+        self.tree_dir = os.path.join(self.dir, 'sequence_tree', 'Viruses')
+        self.files_list = os.path.join(self.dir, 'files.list')
+        self.tax_parents = os.path.join(self.dir, 'tax.parents')
+        self.tax_list = os.path.join(self.dir, 'tax.list')
+        self.reads = os.path.join(self.dir, 'reads.fasta')
+        self.kmers = os.path.join(self.dir, 'db.kmers')
+        self.db = os.path.join(self.dir, 'db.db')
+        self.dbs = os.path.join(self.dir, 'db.dbs')
+        self.dbss = os.path.join(self.dir, 'db.dbss')
+        # tiny inputs for load time
+        self.tiny_tree_dir = os.path.join(self.dir, 'tiny_tree', 'Viruses')
+        self.tiny_files_list = os.path.join(self.dir, 'tiny_files.list')
+        self.tiny_reads = os.path.join(self.dir, 'tiny_reads.fasta')
+
+    @property
+    def genome_bases(self):
+        return self.families * self.species_per_family * self.genome_len
+
+    @property
+    def read_bases(self):
+        return self.read_count * READ_LEN
+
+    def generate(self):
+        done_marker = os.path.join(self.dir, '.generated')
+        if os.path.exists(done_marker):
+            logger.info('%s: using cached data in %s', self.size, self.dir)
+            return
+
+        logger.info('%s: generating data in %s', self.size, self.dir)
+        if not os.path.isdir(self.tree_dir):
+            os.makedirs(self.tree_dir)
+        rnd = random.Random(self.seed)
+
+        # root(1) -> family -> species, species of one family share most of their kmers
+        genomes = []
+        parents = []
+        for family in range(self.families):
+            family_tax_id = 10 + family
+            parents.append((family_tax_id, 1))
+            ancestor = random_seq(rnd, self.genome_len)
+            for species in range(self.species_per_family):
+                tax_id = 1000 + family * self.species_per_family + species
+                parents.append((tax_id, family_tax_id))
+                genome = mutate(rnd, ancestor, 0.05)
+                genomes.append(genome)
+                with open(os.path.join(self.tree_dir, '%d.fasta' % tax_id), 'w') as f:
+                    write_fasta(f, str(tax_id), genome)
+
+        with open(self.tax_parents, 'w') as f: # no trailing newline, TaxIdTreeLoader reads until eof
+            f.write('\n'.join('%d\t%d' % p for p in parents))
+
+        with open(self.files_list, 'w') as f:
+            for name in sorted(os.listdir(self.tree_dir)):
+                path = os.path.join(self.tree_dir, name)
+                f.write('%d\t%s\n' % (os.path.getsize(path), path))
+
+        with open(self.tax_list, 'w') as f:
+            for tax_id, parent in parents[::2]:
+                f.write('%d\n' % tax_id)
+
+        # 80% reads from the genomes with 1% errors, either strand, 20% random
+        with open(self.reads, 'w') as f:
+            for i in range(self.read_count):
+                if rnd.random() < 0.8:
+                    genome = rnd.choice(genomes)
+                    pos = rnd.randrange(len(genome) - READ_LEN)
+                    read = mutate(rnd, genome[pos:pos + READ_LEN], 0.01)
+                    if rnd.random() < 0.5:
+                        read = reverse_complement(read)
+                else:
+                    read = random_seq(rnd, READ_LEN)
+                f.write('>%d\n%s\n' % (i + 1, read))
+
+        if not os.path.isdir(self.tiny_tree_dir):
+            os.makedirs(self.tiny_tree_dir)
+        tiny_genome = os.path.join(self.tiny_tree_dir, '1000.fasta')
+        with open(tiny_genome, 'w') as f:
+            write_fasta(f, '1000', random_seq(rnd, READ_LEN))
+        with open(self.tiny_files_list, 'w') as f:
+            f.write('%d\t%s\n' % (os.path.getsize(tiny_genome), tiny_genome))
+        with open(self.tiny_reads, 'w') as f:
+            f.write('>1\n%s\n' % random_seq(rnd, READ_LEN))
+
+        open(done_marker, 'w').close()
+
+    def build_databases(self, runner):
+        if all(os.path.exists(x) for x in (self.db, self.dbs, self.dbss, self.dbss + '.annotation')):
+            return
+
+        logger.info('%s: building databases', self.size)
+        runner.run_checked(['build_index', self.files_list, self.tax_parents, str(WINDOW_DIVIDER), str(KMER_LEN), str(self.min_window_size)], stdout_path=self.kmers)
+        runner.run_checked(['db_fasta_to_bin', self.kmers, self.dbs])
+        kmers_only = self.kmers + '.no_tax'
+        with open(self.kmers) as src, open(kmers_only, 'w') as dst:
+            for line in src:
+                dst.write(line.split('\t', 1)[0] + '\n')
+        runner.run_checked(['db_fasta_to_bin', kmers_only, self.db])
+        runner.run_checked(['sort_dbs', self.dbs, self.dbss])
+
+class Runner(object):
+    def __init__(self, bin_dir):
+        self.bin_dir = bin_dir
+
+    def command(self, args):
+        return [os.path.join(self.bin_dir, args[0])] + args[1:]
+
+    def run(self, args, threads=None, stdout_path=os.devnull):
+        env = dict(os.environ)
+        if threads:
+            env['OMP_NUM_THREADS'] = str(threads)
+        stderr_path = stdout_path + '.log' if stdout_path != os.devnull else None
+        with open(stdout_path, 'w') as out:
+            start = time.time()
+            p = subprocess.Popen(self.command(args), stdout=out, stderr=subprocess.PIPE, env=env)
+            stderr = p.stderr.read().decode('utf-8', 'replace')
+            _, status, rusage = os.wait4(p.pid, 0)
+            wall = time.time() - start
+        if stderr_path:
+            with open(stderr_path, 'w') as f:
+                f.write(stderr)
+        returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+        peak_rss_mb = rusage.ru_maxrss / 1024.0 # kilobytes on linux
+        return returncode, wall, peak_rss_mb, stderr
+
+    def run_checked(self, args, stdout_path=os.devnull):
+        returncode, wall, _, stderr = self.run(args, stdout_path=stdout_path)
+        if returncode != 0:
+            raise RuntimeError('%s failed (rc=%s): %s' % (' '.join(args), returncode, stderr[-2000:]))
+        return wall
+
+def parse_metrics(stderr):
+    # aligns_to logs a json line with its counters after processing
+    for line in stderr.splitlines():
+        pos = line.find('metrics: {')
+        if pos >= 0:
+            return json.loads(line[pos + len('metrics: '):])
+    return None
+
+def benchmarks(dataset):
+    # (tool, mode, command for an input, input, tiny input for load time, reads processed, kmers hashed)
+    read_kmers = dataset.read_count * (READ_LEN - KMER_LEN + 1)
+    bloom_filter_mb = max(1, dataset.read_count * CONTIG_BUILDER_BLOOM_FILTER_MB_PER_100K_READS // 100000)
+    genome_kmers = dataset.genome_bases
+    build_index = lambda files_list: ['build_index', files_list, dataset.tax_parents, str(WINDOW_DIVIDER), str(KMER_LEN), str(dataset.min_window_size)]
+    return [
+        ('aligns_to', 'db', lambda reads: ['aligns_to', '-db', dataset.db, reads], dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+        ('aligns_to', 'dbs', lambda reads: ['aligns_to', '-dbs', dataset.dbs, reads], dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+        ('aligns_to', 'dbss', lambda reads: ['aligns_to', '-dbss', dataset.dbss, '-tax_list', dataset.tax_list, reads], dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+        ('build_index', '', build_index, dataset.files_list, dataset.tiny_files_list, 0, genome_kmers),
+        ('get_profile', '', lambda reads: ['get_profile', reads, str(KMER_LEN), str(GET_PROFILE_MIN_HASH_COUNT)], dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+        ('contig_builder', '', lambda reads: ['contig_builder', reads], dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+        ('contig_builder', 'bloom', lambda reads: ['contig_builder', reads, '-bloom_filter_mb', str(bloom_filter_mb)],
+            dataset.reads, dataset.tiny_reads, dataset.read_count, read_kmers),
+    ]
+
+def main():
+    parser = argparse.ArgumentParser(description='tax pipeline benchmark on synthetic data')
+    parser.add_argument('--bin-dir', required=True, help='directory with built tax tools')
+    parser.add_argument('--work-dir', default='tax_benchmark_data', help='generated data, kept between runs')
+    parser.add_argument('--sizes', default='small', help='comma separated, of: ' + ', '.join(sorted(SIZES)))
+    parser.add_argument('--threads', default='1,%d' % os.sysconf('SC_NPROCESSORS_ONLN'), help='comma separated thread counts')
+    parser.add_argument('--tools', default='aligns_to,build_index,get_profile,contig_builder', help='comma separated subset of tools')
+    parser.add_argument('--repeat', type=int, default=1, help='runs per configuration')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--report', default='-', help='json lines output, - for stdout')
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s %(levelname)s %(message)s')
+
+    runner = Runner(os.path.abspath(args.bin_dir))
+    tools = set(args.tools.split(','))
+    thread_counts = [int(x) for x in args.threads.split(',')]
+    report = sys.stdout if args.report == '-' else open(args.report, 'w')
+    host = {'host': platform.node(), 'cpus': os.sysconf('SC_NPROCESSORS_ONLN'), 'python': platform.python_version()}
+
+    failed = False
+    for size in args.sizes.split(','):
+        if size not in SIZES:
+            parser.error('unknown size: ' + size)
+        dataset = Dataset(os.path.abspath(args.work_dir), size, args.seed)
+        dataset.generate()
+        dataset.build_databases(runner)
+
+        for tool, mode, command, input_path, tiny_input_path, reads, kmers in benchmarks(dataset):
+            if tool not in tools:
+                continue
+            for threads in thread_counts:
+                tiny_returncode, tiny_wall, _, _ = runner.run(command(tiny_input_path), threads=threads)
+                for attempt in range(args.repeat):
+                    logger.info('%s: %s %s, %d threads', size, tool, mode, threads)
+                    returncode, wall, peak_rss_mb, stderr = runner.run(command(input_path), threads=threads)
+                    record = dict(host)
+                    record.update({
+                        'size': size, 'tool': tool, 'mode': mode, 'threads': threads, 'attempt': attempt,
+                        'returncode': returncode, 'wall_sec': round(wall, 3), 'peak_rss_mb': round(peak_rss_mb, 1),
+                        'reads': reads, 'db_genome_bases': dataset.genome_bases,
+                    })
+                    run_reads = reads
+                    run_kmers = kmers
+                    metrics = parse_metrics(stderr)
+                    if metrics:
+                        record['metrics'] = metrics
+                        processing = metrics['wall_ms'] / 1000.0
+                        run_reads = metrics['reads']
+                        run_kmers = metrics['kmers'] or kmers
+                        load = wall - processing
+                    elif tiny_returncode == 0:
+                        load = min(tiny_wall, wall)
+                        processing = wall - load
+                    else:
+                        load = None
+                        processing = wall
+                    if load is not None:
+                        record['load_sec'] = round(load, 3)
+                    processing = max(processing, 1e-3)
+                    if run_reads:
+                        record['reads_per_sec'] = int(run_reads / processing)
+                    record['kmers_per_sec'] = int(run_kmers / processing)
+                    if returncode != 0:
+                        failed = True
+                        record['error'] = stderr[-2000:]
+                        logger.error('%s %s failed (rc=%s)', tool, mode, returncode)
+                    report.write(json.dumps(record, sort_keys=True) + '\n')
+                    report.flush()
+
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -62,9 +62,19 @@ int main(int argc, char const *argv[])
     if (!config.db.empty())
         job = new DBJob(config);
     else if (!config.dbs.empty())
-        job = new DBSBasicJob(config);
+    {
+        if (DBSIO::load_format(config.dbs).key_bytes == sizeof(__uint128_t))
+            job = new DBSBasicJob<__uint128_t>(config);
+        else
+            job = new DBSBasicJob<uint64_t>(config);
+    }
     else if (!config.dbss.empty())
-        job = new DBSSJob(config);
+    {
+        if (DBSIO::load_format(config.dbss).key_bytes == sizeof(__uint128_t))
+            job = new DBSSJob<__uint128_t>(config);
+        else
+            job = new DBSSJob<uint64_t>(config);
+    }
     else
         Config::fail();
 
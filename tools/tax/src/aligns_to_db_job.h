@@ -55,14 +55,20 @@ struct DBJob : public Job
 		int operator() (const std::string &seq) const 
 		{
 			int found = 0;
+			uint64_t kmers = 0;
 			Hash<hash_t>::for_all_hashes_do(seq, kmer_len, [&](hash_t hash)
 				{
+					kmers++;
 					if (in_db(hash) > 0)
 						found++;
 
 					return !found;
 				});
 
+			auto &metrics = Metrics::local();
+			metrics.kmers += kmers;
+			metrics.lookups += kmers;
+			metrics.hits += found;
 			return found;
 		}
 
@@ -77,7 +83,7 @@ struct DBJob : public Job
 	{
 		Matcher m(hash_array, kmer_len);
 		BasicPrinter print(out_f);
-		Job::run<Matcher, BasicPrinter>(filename, print, m, kmer_len, config.spot_filter_file, config.unaligned_only);
+		Job::run<Matcher, BasicPrinter>(filename, print, m, kmer_len, config);
 	}
 };
 
@@ -28,16 +28,20 @@
 #define ALIGNS_TO_DBS_JOB_H_INCLUDED
 
 #include "aligns_to_job.h"
+#include "mismatch_index.h"
+#include "spaced_seed.h"
 
+// hash_t is uint64_t or __uint128_t, see DBSIO::Format::key_bytes
+template <class hash_t>
 struct DBSJob : public Job
 {
-	struct KmerTax : public DBS::KmerTax
+	struct KmerTax : public DBS::KmerTaxOf<hash_t>
 	{
-		KmerTax(hash_t kmer = 0, int tax_id = 0) : DBS::KmerTax(kmer, tax_id){} // todo: remove constructor from KmerTax for faster loading ?
+		KmerTax(hash_t kmer = 0, int tax_id = 0) : DBS::KmerTaxOf<hash_t>(kmer, tax_id){} // todo: remove constructor from KmerTax for faster loading ?
 
 		bool operator < (const KmerTax &x) const // for binary search by hash
 		{
-			return kmer < x.kmer;
+			return this->kmer < x.kmer;
 		}
 	};
 
@@ -45,9 +49,12 @@ struct DBSJob : public Job
 	typedef std::vector<KmerTax> HashSortedArray;
 
 	HashSortedArray hash_array;
+	typedef MismatchIndex<hash_t, HashSortedArray> KmerMismatchIndex;
+	std::unique_ptr<KmerMismatchIndex> mismatch_index; // -mismatches, built on first run
     static const int DEFAULT_KMER_LEN = 32;
 	typedef unsigned int tax_t;
-	size_t kmer_len;
+	size_t kmer_len; // of keys, i.e. weight of spaced seed
+	std::string seed; // spaced seed, empty for contiguous kmers
 
 protected:
 	DBSJob(const Config &config) : kmer_len(0), config(config)
@@ -69,14 +76,18 @@ public:
 
 	virtual size_t db_kmers() const { return hash_array.size();}
 
-	struct Matcher
+	// Kmers is ContiguousKmers or SpacedKmers, so that every kind of kmers gets its own inlined scanning loop
+	template <class Kmers>
+	struct MatcherOf
 	{
         typedef std::vector< std::pair<size_t, size_t> > HashLookupTable;
 		const HashSortedArray &hash_array;
         HashLookupTable hash_lookup_table;
         int hash_lookup_shift;
+		const Kmers kmers;
 		int kmer_len;
-		Matcher(const HashSortedArray &hash_array, int kmer_len) : hash_array(hash_array), kmer_len(kmer_len)
+		const KmerMismatchIndex *mismatch_index;
+		MatcherOf(const HashSortedArray &hash_array, const Kmers &kmers, const KmerMismatchIndex *mismatch_index = nullptr) : hash_array(hash_array), kmers(kmers), kmer_len(kmers.key_len()), mismatch_index(mismatch_index)
         {
             // determining size of lookup key
             int lookup_key_bits = 1;
@@ -128,55 +139,35 @@ public:
 		Hits operator() (const std::string &seq) const 
 		{
 			Hits hits;
-			Hash<hash_t>::for_all_hashes_do(seq, kmer_len, [&](hash_t hash)
+			uint64_t kmer_count = 0, found = 0;
+			kmers.for_all_hashes_do(seq, [&](hash_t hash)
 				{
+					kmer_count++;
 					if (auto tax_id = get_db_tax(hash))
 					{
 						hits[tax_id] ++;
+						found++;
 //						LOG(tax_id << " " << Hash<hash_t>::str_from_hash(hash, KMER_LEN));
 					}
 
 					return true;
 				});
 
+			auto &metrics = Metrics::local();
+			metrics.kmers += kmer_count;
+			metrics.lookups += kmer_count;
+			metrics.hits += found;
 			return hits;
 		}
 
 		tax_t get_db_tax(hash_t hash) const
 		{
 			auto tax_id = get_db_tax_0_variations(hash);
-#if 0
-			if (tax_id)
+			if (tax_id || !mismatch_index)
 				return tax_id;
-			
-			seq_transform<hash_t>::for_all_1_char_variations_do(hash, KMER_LEN, [&](hash_t hash)
-				{
-					hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-					tax_id = find_hash(hash, 0);
-					return !tax_id;
-				});
-
-			if (tax_id)
-				return tax_id;
-
-			seq_transform<hash_t>::for_all_2_char_variations_do(hash, KMER_LEN, [&](hash_t hash)
-				{
-					hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-					tax_id = find_hash(hash, 0);
-					return !tax_id;
-				});
 
-			if (tax_id)
-				return tax_id;
-
-			seq_transform<hash_t>::for_all_3_char_variations_do(hash, KMER_LEN, [&](hash_t hash)
-				{
-					hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-					tax_id = find_hash(hash, 0);
-					return !tax_id;
-				});
-#endif
-			return tax_id;
+			auto idx = mismatch_index->find(hash);
+			return idx == KmerMismatchIndex::NONE ? 0 : hash_array[idx].tax_id;
 		}
 
 		tax_t get_db_tax_0_variations(hash_t hash) const
@@ -186,6 +177,8 @@ public:
 		}
 	};
 
+	typedef MatcherOf<ContiguousKmers<hash_t>> Matcher;
+
 	struct TaxMatchId
 	{
 		int seq_id;
@@ -201,7 +194,7 @@ public:
         const bool print_counts;
 		TaxPrinter(std::ostream &out_f, bool print_counts) : out_f(out_f), print_counts(print_counts) {}
 
-		void operator() (const std::vector<Reader::Fragment> &processing_sequences, const std::vector<TaxMatchId> &ids)
+		void operator() (const Reader::Chunk &processing_sequences, const std::vector<TaxMatchId> &ids)
 		{
 			for (auto seq_id : ids)
 			{
@@ -223,17 +216,43 @@ public:
 
 	virtual void run(const std::string &filename, std::ostream &out_f)
 	{
-		Matcher m(hash_array, kmer_len);
+		if (config.mismatches && !mismatch_index)
+		{
+			LOG("building " << config.mismatches << " mismatch index");
+			mismatch_index.reset(new KmerMismatchIndex(hash_array, kmer_len, config.mismatches));
+			LOG("mismatch index: " << (mismatch_index->size_in_bytes() / 1024 / 1024) << " MB, " << (mismatch_index->parts.size() * 2) << " probes and on average " << mismatch_index->expected_candidates() << " candidates per missed kmer");
+		}
+
+		if (seed.empty())
+			run_with(filename, out_f, ContiguousKmers<hash_t>(int(kmer_len)));
+		else if (seed.size() <= 32)
+			run_with(filename, out_f, SpacedKmers<hash_t, uint64_t>(seed));
+		else
+			run_with(filename, out_f, SpacedKmers<hash_t, __uint128_t>(seed));
+	}
+
+	template <class Kmers>
+	void run_with(const std::string &filename, std::ostream &out_f, const Kmers &kmers)
+	{
+		if (kmers.key_len() != int(kmer_len))
+			throw std::runtime_error("spaced seed does not match db kmer len");
+
+		MatcherOf<Kmers> m(hash_array, kmers, mismatch_index.get());
 		TaxPrinter print(out_f, !config.hide_counts);
-		Job::run<Matcher, TaxPrinter, TaxMatchId>(filename, print, m, kmer_len, config.spot_filter_file, config.unaligned_only);
+		Job::run<MatcherOf<Kmers>, TaxPrinter, TaxMatchId>(filename, print, m, kmers.span(), config);
 	}
 };
 
-struct DBSBasicJob : public DBSJob
+template <class hash_t>
+struct DBSBasicJob : public DBSJob<hash_t>
 {
-	DBSBasicJob(const Config &config) : DBSJob(config)
+	DBSBasicJob(const Config &config) : DBSJob<hash_t>(config)
 	{
-		kmer_len = DBSIO::load_dbs(config.dbs, hash_array);
+		DBSIO::Format format;
+		this->kmer_len = DBSIO::load_dbs(config.dbs, this->hash_array, &format);
+		this->seed = format.seed;
+		if (!this->seed.empty())
+			LOG("spaced seed " << this->seed);
 	}
 };
 
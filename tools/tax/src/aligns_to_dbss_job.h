@@ -30,21 +30,26 @@
 #include "aligns_to_dbs_job.h"
 #include <set>
 
-struct DBSSJob : public DBSJob
+template <class hash_t>
+struct DBSSJob : public DBSJob<hash_t>
 {
-	DBSSJob(const Config &config) : DBSJob(config)
-	{
-		DBSIO::DBSHeader header;
+	using DBSJob<hash_t>::hash_array;
+	using DBSJob<hash_t>::kmer_len;
+	using DBSJob<hash_t>::seed;
 
-	    std::ifstream f(config.dbss, std::ios::binary | std::ios::in);
-	    if (f.fail() || f.eof())
-		    throw std::runtime_error(std::string("cannot open dbss ") + config.dbss);
+	DBSSJob(const Config &config) : DBSJob<hash_t>(config)
+	{
+		auto format = DBSIO::load_format(config.dbss);
+		if (format.key_bytes != sizeof(hash_t))
+			throw std::runtime_error("unexpected dbss key size");
 
-		IO::read(f, header);
-		kmer_len = header.kmer_len;
+		kmer_len = format.kmer_len;
+		seed = format.seed;
+		if (!seed.empty())
+			LOG("spaced seed " << seed);
 
 		DBSAnnotation annotation;
-		auto sum_offset = load_dbs_annotation(config.dbss + ".annotation", annotation);
+		auto sum_offset = load_dbs_annotation(config.dbss + ".annotation", format.header_size(), annotation);
 		if (sum_offset != IO::filesize(config.dbss))
 			throw std::runtime_error("inconsistent dbss annotation file");
 
@@ -73,13 +78,13 @@ struct DBSSJob : public DBSJob
 	typedef std::vector<DBSAnnot> DBSAnnotation;
 	typedef std::vector<tax_id_t> TaxList;
 
-	static size_t load_dbs_annotation(const std::string &filename, DBSAnnotation &annotation)
+	static size_t load_dbs_annotation(const std::string &filename, size_t header_size, DBSAnnotation &annotation)
 	{
 		std::ifstream f(filename);
 		if (f.fail())
 			throw std::runtime_error("cannot open annotation file");
 
-		size_t offset = sizeof(DBSIO::DBSHeader) + sizeof(size_t);
+		size_t offset = header_size + sizeof(size_t);
 		tax_id_t prev_tax = 0;
 
 		while (!f.eof())
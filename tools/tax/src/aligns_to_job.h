@@ -29,9 +29,13 @@
 
 #include <time.h>
 #include <thread>
+#include <atomic>
 #include "log.h"
+#include "metrics.h"
+#include "screening.h"
+#include "config_align_to.h"
 #include "reader.h"
-#include "fasta_reader.h"
+#include "parallel_fasta_reader.h"
 
 struct BasicMatchId
 {
@@ -46,7 +50,7 @@ struct BasicPrinter
 	std::ostream &out_f;
 	BasicPrinter(std::ostream &out_f) : out_f(out_f){}
 
-	void operator() (const std::vector<Reader::Fragment> &processing_sequences, const std::vector<BasicMatchId> &ids)
+	void operator() (const Reader::Chunk &processing_sequences, const std::vector<BasicMatchId> &ids)
 	{
 		for (auto seq_id : ids)
 			out_f << processing_sequences[seq_id.seq_id].spotid << std::endl;
@@ -58,59 +62,134 @@ struct Job
 	virtual void run(const std::string &contig_filename, std::ostream &out_f) = 0;
 
 	template <class Matcher, class Printer, class MatchId = BasicMatchId>
-	static void run(const std::string &contig_filename, Printer &print, Matcher &matcher, size_t min_sequence_len, const std::string &spot_filter_file, bool unaligned_only)
+	static void run(const std::string &contig_filename, Printer &print, Matcher &matcher, size_t min_sequence_len, const Config &config)
 	{
 		Progress progress;
+        Metrics::reset();
+        auto start = std::chrono::high_resolution_clock::now();
         Reader::Params params;
-        params.filter_file = spot_filter_file;
+        params.filter_file = config.spot_filter_file;
         params.split_non_atgc = true;
-        params.unaligned_only = unaligned_only;
+        params.unaligned_only = config.unaligned_only;
+        params.vdb_blobs = config.vdb_blobs;
+        params.sample_fraction = config.sample_fraction;
+        params.random_order = config.screen_threshold > 0;
+        if (config.screen_threshold > 0)
+            params.random_ranges = ScreeningTest::RANGES;
         auto reader = Reader::create(contig_filename, params);
 
+        // a sequential prefix is not a sample, so without random order the whole input is read
+        const bool screen = config.screen_threshold > 0 && reader->random_order();
+        if (config.screen_threshold > 0 && !screen)
+            LOG("screening is off, " << contig_filename << " can not be read in random order");
+
+        ScreeningTest screening(config.screen_threshold);
+        std::atomic<bool> stop(false); // screening decided
+
         #pragma omp parallel
         {
             std::vector<MatchId> matched_ids;
-            std::vector<Reader::Fragment> chunk;
+            Reader::Chunk chunk;
+            auto& metrics = Metrics::local();
+            size_t sampled_ranges = 0;
             bool done = false;
             while (!done) {
-                #pragma omp critical (read)
+                uint64_t read_ns = 0;
                 {
-                    done = !reader->read_many(chunk);
-                    progress.report(reader->progress());
+                    Metrics::Timer wait_timer(metrics.read_wait_ns); // includes read_ns, subtracted below
+                    #pragma omp critical (read)
+                    {
+                        Metrics::Timer read_timer(read_ns);
+                        if (stop) {
+                            chunk.clear();
+                            done = true;
+                        } else {
+                            done = !reader->read_many(chunk);
+                            progress.report(reader->progress());
+                            if (screen)
+                                sampled_ranges = reader->sampled_ranges();
+                        }
+                    }
                 }
+                metrics.read_wait_ns -= read_ns;
+                metrics.read_ns += read_ns;
 
                 matched_ids.clear();
-                for (size_t seq_id = 0; seq_id < chunk.size(); ++seq_id) {
-                    auto& spotid = chunk[seq_id].spotid;
-                    auto& bases = chunk[seq_id].bases;
-                    //processed_spots.insert(spotid);
-                    if (bases.size() >= min_sequence_len) {
-                        if (auto m = matcher(bases)) {
-                            //identified_spots.insert(spotid);
-                            matched_ids.push_back(MatchId(seq_id, m));
+                // screening counts spots: pieces and mates of a spot come one after another
+                // (a spot cut by a chunk boundary counts in both chunks)
+                size_t spots = 0, matched_spots = 0;
+                {
+                    Metrics::Timer match_timer(metrics.match_ns);
+                    const std::string *last_spotid = nullptr;
+                    bool last_spot_matched = false;
+                    for (size_t seq_id = 0; seq_id < chunk.size(); ++seq_id) {
+                        auto& spotid = chunk[seq_id].spotid;
+                        auto& bases = chunk[seq_id].bases;
+                        metrics.bases += bases.size();
+                        if (!last_spotid || *last_spotid != spotid) {
+                            last_spotid = &spotid;
+                            last_spot_matched = false;
+                            spots++;
+                        }
+                        //processed_spots.insert(spotid);
+                        if (bases.size() >= min_sequence_len) {
+                            if (auto m = matcher(bases)) {
+                                //identified_spots.insert(spotid);
+                                matched_ids.push_back(MatchId(seq_id, m));
+                                if (!last_spot_matched) {
+                                    last_spot_matched = true;
+                                    matched_spots++;
+                                }
+                            }
                         }
                     }
                 }
+                metrics.reads += chunk.size();
+                metrics.matched_reads += matched_ids.size();
 
-                #pragma omp critical (output)
+                uint64_t print_ns = 0;
                 {
-                    print(chunk, matched_ids);
+                    Metrics::Timer wait_timer(metrics.print_wait_ns);
+                    #pragma omp critical (output)
+                    {
+                        Metrics::Timer print_timer(print_ns);
+                        print(chunk, matched_ids);
+                        if (screen && !chunk.empty() && screening.add(spots, matched_spots, sampled_ranges) != ScreeningTest::UNDECIDED) {
+                            stop = true;
+                        }
+                    }
                 }
+                metrics.print_wait_ns -= print_ns;
+                metrics.print_ns += print_ns;
             }
 
         }
 
         progress.report(1, true); // always report 100%, needed by pipeline for proper progress report
 
+        if (screen) {
+            double low, high;
+            screening.interval(&low, &high);
+            LOG("screening: " << ScreeningTest::to_string(screening.decision) << ", matched " << screening.matched << " of " << screening.reads << " spots in " << screening.ranges << " ranges (" << screening.fraction() << ", interval " << low << " - " << high << ", threshold " << screening.threshold << ")");
+        }
+
+        if (stop) {
+            LOG("stopped early, " << screening.reads << " spots processed");
+        } else if (config.sample_fraction < 1) {
+            LOG("sampled " << config.sample_fraction << " of input, " << Metrics::total().reads << " reads processed");
+        }
+
         Reader::SourceStats total_stats;
-        if (unaligned_only) {
+        if (stop) {
+            // reader did not reach the end, its stats are not available
+        } else if (config.unaligned_only) {
             auto unaligned_stats = reader->stats();
             LOG("unaligned spot count: " << unaligned_stats.spot_count);
             LOG("unaligned read count: " << unaligned_stats.frag_count());
         
             Reader::Params total_params;
             total_params.thread_count = 0;
-            if (FastaReader::is_fasta(contig_filename)) {
+            if (ParallelFastaReader::is_supported(contig_filename)) {
                 total_stats = unaligned_stats;
             } else {
                 total_stats = Reader::create(contig_filename, total_params)->stats();
@@ -118,9 +197,14 @@ struct Job
         } else {
             total_stats = reader->stats();
         }
-        
-        LOG("total spot count: " << total_stats.spot_count);
-        LOG("total read count: " << total_stats.frag_count());
+
+        if (!stop) {
+            LOG("total spot count: " << total_stats.spot_count);
+            LOG("total read count: " << total_stats.frag_count());
+        }
+
+        auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        LOG("metrics: " << Metrics::total().to_json(wall_ns));
 	}
 
 	virtual size_t db_kmers() const { return 0;}
@@ -27,9 +27,10 @@
 #pragma once
 
 #include "reader.h"
+#include "spot_set.h"
 #include <algorithm>
 #include <iostream>
-#include <unordered_set>
+#include <memory>
 
 static bool is_actg(char ch) { return ch == 'A' || ch == 'C' || ch == 'T' || ch == 'G'; }
 static bool non_actg(char ch) { return !is_actg(ch); }
@@ -52,32 +53,29 @@ public:
     bool is_good(const std::string& spotid) const override { return callable(spotid); }
 };
 
+typedef std::shared_ptr<const SpotSet> SpotSetPtr;
+
 class BaseFileSpotFilter: public SpotFilter {
 protected:
-    std::unordered_set<std::string> file_spots;
+    SpotSetPtr file_spots;
 public:
-    BaseFileSpotFilter(const std::string& path) {
-        std::ifstream is(path);
-        std::string line;
-        while (std::getline(is, line)) {
-            auto dot_it = std::find(line.begin(), line.end(), '.');
-            line.resize(dot_it - line.begin()); // strip dot and everything after
-            file_spots.insert(line);
-        }
-    }
+    BaseFileSpotFilter(const std::string& path) : file_spots(std::make_shared<SpotSet>(path)) {}
+    BaseFileSpotFilter(const SpotSetPtr& spots) : file_spots(spots) {}
 };
 
 class IncludeFileSpotFilter final: public BaseFileSpotFilter {
 public:
     IncludeFileSpotFilter(const std::string& path) : BaseFileSpotFilter(path) {}
-    size_t expected_spot_count() const override { return file_spots.size(); }
-    bool is_good(const std::string& spotid) const override { return file_spots.count(spotid) > 0; }
+    IncludeFileSpotFilter(const SpotSetPtr& spots) : BaseFileSpotFilter(spots) {}
+    size_t expected_spot_count() const override { return file_spots->size(); }
+    bool is_good(const std::string& spotid) const override { return file_spots->contains(spotid); }
 };
 
 class ExcludeFileSpotFilter final: public BaseFileSpotFilter {
 public:
     ExcludeFileSpotFilter(const std::string& path) : BaseFileSpotFilter(path) {}
-    bool is_good(const std::string& spotid) const override { return file_spots.count(spotid) == 0; }
+    ExcludeFileSpotFilter(const SpotSetPtr& spots) : BaseFileSpotFilter(spots) {}
+    bool is_good(const std::string& spotid) const override { return !file_spots->contains(spotid); }
 };
 
 // only keeps spots with spotids passing the filter
@@ -86,6 +84,7 @@ class FilteringReader final: public Reader {
 private:
     ReaderType reader;
     FilterType filter;
+    Fragment temp; // for skipped output, keeps its buffers between reads
     
 public:
     template <typename... ReaderArgs>
@@ -105,9 +104,10 @@ public:
         return stats;
     }
     float progress() const override { return reader.progress(); }
+    bool random_order() const override { return reader.random_order(); }
+    size_t sampled_ranges() const override { return reader.sampled_ranges(); }
 
     virtual bool read(Fragment* output) override {
-        Fragment temp;
         if (!output) {
             output = &temp;
         }
@@ -120,6 +120,99 @@ public:
     }
 };
 
+// only reads rows listed in a numeric spot set, long gaps between selected rows are skipped without reading
+// ReaderType is a seekable reader with rows as range units and row ids as spot ids (see VdbReader)
+// same output as FilteringReader with IncludeFileSpotFilter, and seekable itself, so MTReader can split it
+// gaps up to MAX_GAP rows are read through and filtered, so dense scattered selections do not cost a seek per row
+template <typename ReaderType>
+class SelectedRowsReader final: public Reader {
+private:
+    static const uint64_t MAX_GAP = 256;
+
+    ReaderType reader;
+    SpotSetPtr rows;
+    uint64_t next_row; // row ids are 1 based
+    uint64_t range_end;
+    bool in_run;
+    bool run_has_gaps; // run includes unselected rows, so reads have to be filtered
+    Fragment temp; // for skipped output of runs with gaps
+
+    // moves reader to the next run of selected rows, merging runs with short gaps between them
+    bool next_run() {
+        const uint64_t first = next_row < range_end ? rows->next(next_row) : SpotSet::NONE;
+        if (first == SpotSet::NONE || first >= range_end) {
+            next_row = range_end;
+            return false;
+        }
+        uint64_t last = first + 1;
+        run_has_gaps = false;
+        while (last < range_end) {
+            if (rows->contains(last)) {
+                ++last;
+                continue;
+            }
+            const uint64_t next = rows->next(last);
+            if (next == SpotSet::NONE || next >= range_end || next - last > MAX_GAP) {
+                break;
+            }
+            last = next + 1;
+            run_has_gaps = true;
+        }
+        reader.set_range(size_t(first - 1), size_t(last - first));
+        next_row = last;
+        return true;
+    }
+
+public:
+    template <typename... ReaderArgs>
+    SelectedRowsReader(const SpotSetPtr& rows, ReaderArgs... reader_args)
+        : reader(reader_args...)
+        , rows(rows)
+        , run_has_gaps(false)
+    {
+        assert(rows->is_numeric());
+        set_range(0, range_units());
+    }
+
+    SourceStats stats() const override {
+        auto stats = reader.stats();
+        stats.expected_spot_count = std::min(stats.expected_spot_count, rows->size());
+        return stats;
+    }
+    float progress() const override { return next_row >= range_end && !in_run ? 1 : reader.progress(); }
+
+    // seekable reader interface, see MTReader
+    size_t range_units() const { return reader.range_units(); }
+
+    void set_range(size_t first, size_t count) {
+        next_row = first + 1;
+        range_end = first + count + 1;
+        in_run = false;
+    }
+
+    static SourceStats merge_range_stats(const std::vector<SourceStats>& stats) {
+        return ReaderType::merge_range_stats(stats);
+    }
+
+    bool read(Fragment* output) override {
+        if (!output && run_has_gaps) {
+            output = &temp;
+        }
+        while (true) {
+            if (in_run && reader.read(output)) {
+                if (!run_has_gaps || rows->contains(output->spotid)) {
+                    return true;
+                }
+                continue;
+            }
+            in_run = next_run();
+            if (!in_run) {
+                return false;
+            }
+        }
+    }
+};
+
 // splits reads by non-atgs values
 template <typename ReaderType>
 class SplittingReader final: public Reader {
@@ -134,6 +227,8 @@ public:
 
     SourceStats stats() const override { return reader.stats(); }
     float progress() const override { return reader.progress(); }
+    bool random_order() const override { return reader.random_order(); }
+    size_t sampled_ranges() const override { return reader.sampled_ranges(); }
 
     virtual bool read(Fragment* output) override {
         while (true) {
@@ -148,7 +243,9 @@ public:
             auto to = std::find_if(from, last.bases.end(), non_actg);
             if (from == last.bases.begin() && to == last.bases.end()) {
                 if (output) {
-                    std::swap(*output, last);
+                    // copying instead of swapping keeps buffers where they are, so both sides stay warm
+                    output->spotid = last.spotid;
+                    output->bases = last.bases;
                 }
                 offset = last.bases.size();
                 return true;
@@ -171,6 +268,7 @@ template <typename ReaderType>
 class CuttingReader final: public Reader {
 private:
     ReaderType reader;
+    Fragment temp; // for skipped output, keeps its buffers between reads
     
 public:
     template <typename... ReaderArgs>
@@ -178,10 +276,11 @@ public:
 
     SourceStats stats() const override { return reader.stats(); }
     float progress() const override { return reader.progress(); }
+    bool random_order() const override { return reader.random_order(); }
+    size_t sampled_ranges() const override { return reader.sampled_ranges(); }
 
     bool read(Fragment* output) override {
         while (true) {
-            Fragment temp;
             if (!output) {
                 output = &temp;
             }
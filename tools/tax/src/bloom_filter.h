@@ -0,0 +1,80 @@
+#ifndef BLOOM_FILTER_H_INCLUDED
+#define BLOOM_FILTER_H_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+// lock free blocked bloom filter for kmer hashes
+// all bits of one kmer live in the same 64 bit word, so add() is a single fetch_or:
+// when two threads add the same kmer concurrently, exactly one of them sees it as new
+template <class hash_t>
+struct BloomFilter
+{
+	static const int BITS_PER_KMER = 4;
+
+	size_t word_count; // power of 2
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+
+	BloomFilter(size_t size_in_bytes) : word_count(1)
+	{
+		while (word_count * 2 * sizeof(uint64_t) <= size_in_bytes)
+			word_count *= 2;
+
+		words.reset(new std::atomic<uint64_t>[word_count]);
+		for (size_t i = 0; i < word_count; i++)
+			words[i].store(0, std::memory_order_relaxed);
+	}
+
+	size_t size_in_bytes() const
+	{
+		return word_count * sizeof(uint64_t);
+	}
+
+	// returns true if the hash was (probably) added before
+	bool add(hash_t hash)
+	{
+		uint64_t mask = 0;
+		auto &word = words[word_of(hash, &mask)];
+		return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == mask;
+	}
+
+	bool contains(hash_t hash) const
+	{
+		uint64_t mask = 0;
+		auto &word = words[word_of(hash, &mask)];
+		return (word.load(std::memory_order_relaxed) & mask) == mask;
+	}
+
+	double fill_ratio() const
+	{
+		size_t bits = 0;
+		for (size_t i = 0; i < word_count; i++)
+			bits += __builtin_popcountll(words[i].load(std::memory_order_relaxed));
+
+		return double(bits) / (word_count * 64);
+	}
+
+private:
+	static uint64_t mix(uint64_t x) // splitmix64 finalizer
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	size_t word_of(hash_t hash, uint64_t *mask) const
+	{
+		auto h1 = mix(uint64_t(hash));
+		auto h2 = mix(h1 ^ uint64_t(hash >> 1));
+		for (int i = 0; i < BITS_PER_KMER; i++)
+			*mask |= uint64_t(1) << ((h2 >> (6 * i)) & 63);
+
+		return h1 & (word_count - 1);
+	}
+};
+
+#endif
@@ -32,6 +32,7 @@
 #include <fstream>
 #include <list>
 #include <stdexcept>
+#include <cstdlib>
 #include "log.h"
 
 struct Config
@@ -41,10 +42,18 @@ struct Config
 	Strings contig_files;
     bool unaligned_only;
     bool hide_counts;
+    int mismatches;
+    float sample_fraction;
+    float screen_threshold;
+    bool vdb_blobs;
 
 	Config(int argc, char const *argv[])
         : hide_counts(false)
         , unaligned_only(false)
+        , mismatches(0)
+        , sample_fraction(1)
+        , screen_threshold(0)
+        , vdb_blobs(false)
 	{
         std::list<std::string> args;
         for (int i = 1; i < argc; ++i) {
@@ -69,6 +78,23 @@ struct Config
                 contig_files = load_list(pop_arg(args));
             } else if (arg == "-spot_filter") {
                 spot_filter_file = pop_arg(args);
+            } else if (arg == "-mismatches") {
+                mismatches = std::atoi(pop_arg(args).c_str());
+                if (mismatches < 1 || mismatches > 3) {
+                    fail("-mismatches should be 1, 2 or 3");
+                }
+            } else if (arg == "-sample") {
+                sample_fraction = float(std::atof(pop_arg(args).c_str()));
+                if (!(sample_fraction > 0 && sample_fraction <= 1)) {
+                    fail("-sample should be in (0, 1]");
+                }
+            } else if (arg == "-screen") {
+                screen_threshold = float(std::atof(pop_arg(args).c_str()));
+                if (!(screen_threshold > 0 && screen_threshold < 1)) {
+                    fail("-screen should be in (0, 1)");
+                }
+            } else if (arg == "-vdb_blobs") {
+                vdb_blobs = true;
             } else if (arg.empty() || arg[0] == '-' || !contig_file.empty()) {
                 std::string reason = "unexpected argument: " + arg;
                 fail(reason.c_str());
@@ -91,6 +117,10 @@ struct Config
         if (dbss.empty() != dbss_tax_list.empty()) {
             fail("-tax_list should be used with -dbss");
         }
+
+        if (mismatches && !db.empty()) {
+            fail("-mismatches should be used with -dbs or -dbss");
+        }
         
 	}
 
@@ -107,7 +137,15 @@ struct Config
             << "where <database> is one of:" << std::endl
             << "-db <database>" << std::endl
             << "-dbs <database +tax>" << std::endl
-            << "-dbss <sorted database +tax> -tax_list <tax_list file>")
+            << "-dbss <sorted database +tax> -tax_list <tax_list file>" << std::endl
+            << "-mismatches <1..3> (with -dbs/-dbss) also matches kmers with up to this many mismatches, for divergent strains." << std::endl
+            << "  costs (mismatches + 1) * ~5 bytes of ram per db kmer, 1 is cheap, 2 and 3 are slow for big dbs, expected cost is logged" << std::endl
+            << "-sample <fraction> reads only this fraction of the input, random row ranges (vdb runs and uncompressed fasta)" << std::endl
+            << "-screen <matched spots fraction> reads the input in random order of small ranges and stops as soon as" << std::endl
+            << "  the fraction of matched spots is confidently above (present) or below (absent) the threshold" << std::endl
+            << "  (vdb runs and uncompressed fasta, other inputs are read whole)" << std::endl
+            << "-vdb_blobs (experimental) reads unaligned vdb runs straight from READ blobs in one background thread" << std::endl
+            << "  instead of row ranges in several threads, empty reads are not counted")
 	}
 
 private:
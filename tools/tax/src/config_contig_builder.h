@@ -10,12 +10,14 @@ struct Config
 	bool unaligned_only;
 	std::string filter_file;
     bool exclude_filter;
+	int bloom_filter_mb;
 
 	Config(int argc, char const *argv[]) : 
 		accession(nullptr), 
 		min_contig_len(200), 
 		unaligned_only(false),
-        exclude_filter(false)
+        exclude_filter(false),
+		bloom_filter_mb(0)
 	{
 		auto cmdline_acc = get_cmdline_accession(argc, argv);
 		if (cmdline_acc)
@@ -43,7 +45,8 @@ struct Config
             << "-min_contig_len <number>" << std::endl
  //		<< "-max_ram <gigabytes>" << std::endl
             << "-filter_file <filename>" << std::endl
-            << "-exclude_filter");
+            << "-exclude_filter" << std::endl
+            << "-bloom_filter_mb <megabytes> (two pass loading, count-1 kmers are not stored)");
 	}
 
 	void parse_options(int argc, char const *argv[], int pos)
@@ -61,6 +64,8 @@ struct Config
 //				pos++;
 			else if (get_str_value("-filter_file", argv, argc, pos, &filter_file))
 				pos++;
+			else if (get_int_value("-bloom_filter_mb", argv, argc, pos, &bloom_filter_mb))
+				pos++;
 			else {
                 LOG("bad option: " << arg);
                 exit(1);
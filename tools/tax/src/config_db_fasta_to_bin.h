@@ -33,11 +33,11 @@
 
 struct Config
 {
-	std::string fasta_db, out_file;
+	std::string fasta_db, out_file, seed;
 
 	Config(int argc, char const *argv[])
 	{
-		if (argc < 3)
+		if (argc != 3 && !(argc == 5 && std::string(argv[3]) == "-seed"))
 		{
 			print_usage();
 			exit(1);
@@ -45,11 +45,18 @@ struct Config
 
 		fasta_db = argv[1];
 		out_file = argv[2];
+		if (argc == 5)
+			seed = argv[4];
+
+		if (seed.find('0') == std::string::npos) // all ones is a contiguous kmer
+			seed.clear();
 	}
 
 	static void print_usage()
 	{
-		LOG("need <fasta db> <out file>");
+		LOG("need <fasta db> <out file> [-seed <spaced seed>]" << std::endl
+			<< "kmers longer than 32 are stored as 128 bit keys" << std::endl
+			<< "spaced seed is like 1101101011 and has to be symmetric, kmers in fasta db should be of its length");
 	}
 
 };
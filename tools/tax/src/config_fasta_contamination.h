@@ -9,6 +9,8 @@
 struct Config
 {
 	std::string file_list, dbs;
+	int threads;
+	bool summary;
 	int argc;
 	char const **argv;
 
@@ -20,10 +22,24 @@ struct Config
 		return std::string(argv[index]);
 	}
 
-	Config(int argc, char const *argv[]) : argc(argc), argv(argv) // todo: make it right
+	Config(int argc, char const *argv[]) : threads(0), summary(false), argc(argc), argv(argv) // todo: make it right
 	{
 		file_list = arg(1);
 		dbs = arg(2);
+
+		for (int i = 3; i < argc; i++)
+		{
+			auto option = arg(i);
+			if (option == "-summary")
+				summary = true;
+			else if (option == "-threads")
+				threads = std::stoi(arg(++i));
+			else
+			{
+				std::cerr << "bad option: " << option << std::endl;
+				fail();
+			}
+		}
 	}
 
 	void fail() const
@@ -34,7 +50,8 @@ struct Config
 
 	static void print_usage()
 	{
-		std::cerr << "need <files.list> <dbs>" << std::endl;
+		std::cerr << "need <files.list> <dbs> [-threads <number>] [-summary]" << std::endl
+			<< "-summary: one ranked line per file (filename, hits, sequences with hits, tax_id:hits), individual hits are not kept" << std::endl;
 	}
 
 };
@@ -14,7 +14,7 @@
 using namespace std;
 using namespace std::chrono;
 
-const string VERSION = "0.19";
+const string VERSION = "0.21";
 
 typedef std::list<string> Strings;
 
@@ -41,38 +41,43 @@ Strings build_contigs(MainKmerMap &kmers, int MIN_SEQUENCE_LEN)
 	LOG("building begins time is (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( high_resolution_clock::now() - before ).count());
 	LOG("mem usage before build_contigs (G) " << mem_usage()/1000000000);
 
-	typename MainKmerMap::hash_t hash = 0;
-
-	before = high_resolution_clock::now();
-
-	std::chrono::duration<double> perf_begin, perf_contig;
-
-	Strings contigs;
+	std::vector<string> pieces;
+	size_t seeds = 0;
 
 	auto before_loop = high_resolution_clock::now();
-	while (true)
+	#pragma omp parallel
 	{
-		before = high_resolution_clock::now();
-
-		if (!begins.next(&hash))
-			break;
-
-		hash = restore_orientation(hash, kmers);
-
-		perf_begin += high_resolution_clock::now() - before;
-
-		before = high_resolution_clock::now();
-		string contig = ContigBuilder::get_next_contig(kmers, hash);
-
-		if (contig.length() >= MIN_SEQUENCE_LEN)
-			contigs.push_back(contig);
-
-		perf_contig += high_resolution_clock::now() - before;
+		std::vector<string> thread_pieces;
+		typename MainKmerMap::hash_t hash = 0;
+		bool has_begin = true;
+		while (has_begin)
+		{
+			#pragma omp critical (begins)
+			{
+				has_begin = begins.next(&hash);
+				seeds += has_begin;
+			}
+
+			if (!has_begin)
+				break;
+
+			string contig = ContigBuilder::get_next_contig(kmers, restore_orientation(hash, kmers));
+
+			if (contig.length() >= MIN_SEQUENCE_LEN || ContigBuilder::may_stitch(kmers, contig))
+				thread_pieces.push_back(std::move(contig));
+		}
+
+		#pragma omp critical (contigs)
+		for (auto &piece : thread_pieces)
+			pieces.push_back(std::move(piece));
 	}
 
+	Strings contigs = ContigBuilder::stitch(kmers, pieces);
+	LOG("stitched " << pieces.size() << " pieces into " << contigs.size() << " contigs");
+	contigs.remove_if([MIN_SEQUENCE_LEN](const string &contig) { return contig.length() < MIN_SEQUENCE_LEN; });
+
 	LOG("building contigs time is (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( high_resolution_clock::now() - before_loop ).count());
-	LOG("perf begin   (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( perf_begin ).count());
-	LOG("perf contig  (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( perf_contig ).count());
+	LOG("threads: " << omp_get_max_threads() << ", seeds: " << seeds);
 
 	return contigs;
 }
@@ -124,12 +129,13 @@ int main(int argc, char const *argv[])
 	LOG("-min_contig_len: " << config.min_contig_len);
 	LOG("-filter_file: " << config.filter_file);
     LOG("-exclude_filter: " << config.exclude_filter);
+	LOG("-bloom_filter_mb: " << config.bloom_filter_mb);
 
 	auto before = high_resolution_clock::now();
 
 	KmerMap32 kmers;
 
-	KmerLoader loader(kmers, config.unaligned_only, config.filter_file, config.exclude_filter);
+	KmerLoader loader(kmers, config.unaligned_only, config.filter_file, config.exclude_filter, config.bloom_filter_mb);
 	loader.load(acc);
 
     Strings contigs_seqs = build_contigs(kmers, config.min_contig_len);
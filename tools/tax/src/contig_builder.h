@@ -11,6 +11,7 @@
 #include <string>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <chrono>
 #include <thread>
 #include "omp_adapter.h"
@@ -23,18 +24,17 @@ struct ContigBuilder
 	static const int LAST_LETTERS_COUNT = 4;
 
 	template <class KmerMap>
-	static char choose_next_letter(KmerMap &kmers, typename KmerMap::hash_t *_hash, int min_coverage = MIN_COVERAGE)
+	static char choose_next_letter(KmerMap &kmers, typename KmerMap::hash_t *_hash, int min_coverage = MIN_COVERAGE, bool with_claimed = false)
 	{
 		auto hash = *_hash;
 		const char LAST_LETTERS[LAST_LETTERS_COUNT] = {'A', 'C', 'T', 'G'};
 		typename KmerMap::hash_t hashes[LAST_LETTERS_COUNT];
 		unsigned int cov[LAST_LETTERS_COUNT]; 
-	
-        #pragma omp parallel for num_threads(LAST_LETTERS_COUNT)
+
 		for (int i = 0; i < LAST_LETTERS_COUNT; i++)
 		{
 			hashes[i] = Hash<typename KmerMap::hash_t>::hash_next(LAST_LETTERS[i], hash, kmers.kmer_len);
-			cov[i] = kmers.coverage_of(hashes[i]); 
+			cov[i] = with_claimed ? kmers.coverage_of_no_deleted_check(hashes[i]) : kmers.coverage_of(hashes[i]);
 		}
 
 		int best_letter_index = 0;
@@ -59,18 +59,25 @@ struct ContigBuilder
 		return LAST_LETTERS[best_letter_index];
 	}
 
+	// kmers are claimed one by one, so several threads can build contigs from the same map
+	// returns empty string if start_from is already taken by another contig
 	template <class KmerMap>
 	static std::string get_next_contig(KmerMap &kmers, typename KmerMap::hash_t start_from, int min_coverage = MIN_COVERAGE)
 	{
-		std::string seq = Hash<typename KmerMap::hash_t>::str_from_hash(start_from, kmers.kmer_len);
 		auto hash = start_from;
-		kmers.remove(hash);
+		if (!kmers.claim(hash))
+			return std::string();
+
+		std::string seq = Hash<typename KmerMap::hash_t>::str_from_hash(start_from, kmers.kmer_len);
 
 		bool was_reversed = false;
 
 		while (true)
 		{
 			char next_letter = choose_next_letter<KmerMap>(kmers, &hash, min_coverage);
+			if (next_letter && !kmers.claim(hash))
+				next_letter = 0; // another thread got there first
+
 			if (!next_letter)
 			{
 				if (!was_reversed)
@@ -86,11 +93,108 @@ struct ContigBuilder
 				}
 			}
 			else
-			{
-				kmers.remove(hash);
 				seq += next_letter;
+		}
+	}
+
+	// contigs built in parallel stop where they meet another thread's contig, so they are stitched afterwards:
+	// two contig ends are joined if each of them would have been extended into the other one had it not been claimed.
+	// contigs built one by one never stop like this, so for a single thread stitching changes nothing
+
+	template <class KmerMap>
+	static typename KmerMap::hash_t end_hash(const KmerMap &kmers, const std::string &contig, bool right)
+	{
+		typedef typename KmerMap::hash_t hash_t;
+		if (right)
+			return Hash<hash_t>::hash_of(&contig[contig.length() - kmers.kmer_len], kmers.kmer_len);
+
+		return seq_transform<hash_t>::to_rev_complement(Hash<hash_t>::hash_of(&contig[0], kmers.kmer_len), kmers.kmer_len);
+	}
+
+	// end is the contig end kmer, oriented outwards. returns the neighbour end kmer oriented the same way
+	template <class KmerMap>
+	static bool neighbour_end(KmerMap &kmers, typename KmerMap::hash_t end, typename KmerMap::hash_t *neighbour, int min_coverage = MIN_COVERAGE)
+	{
+		typedef typename KmerMap::hash_t hash_t;
+		auto next = end;
+		if (!choose_next_letter<KmerMap>(kmers, &next, min_coverage, true))
+			return false;
+
+		auto back = seq_transform<hash_t>::to_rev_complement(next, kmers.kmer_len);
+		*neighbour = back;
+		return choose_next_letter<KmerMap>(kmers, &back, min_coverage, true) && back == seq_transform<hash_t>::to_rev_complement(end, kmers.kmer_len);
+	}
+
+	// true if the contig should be kept for stitching even when it is too short to be reported
+	template <class KmerMap>
+	static bool may_stitch(KmerMap &kmers, const std::string &contig, int min_coverage = MIN_COVERAGE)
+	{
+		typename KmerMap::hash_t neighbour;
+		return contig.length() >= size_t(kmers.kmer_len) &&
+			(neighbour_end(kmers, end_hash(kmers, contig, false), &neighbour, min_coverage) || neighbour_end(kmers, end_hash(kmers, contig, true), &neighbour, min_coverage));
+	}
+
+	template <class KmerMap>
+	static std::list<std::string> stitch(KmerMap &kmers, const std::vector<std::string> &contigs, int min_coverage = MIN_COVERAGE)
+	{
+		typedef typename KmerMap::hash_t hash_t;
+		const size_t NONE = size_t(-1);
+
+		// contig ends are numbered contig*2 + right
+		std::unordered_map<hash_t, size_t> ends;
+		for (size_t i = 0; i < contigs.size(); i++)
+			if (contigs[i].length() >= size_t(kmers.kmer_len))
+				for (int right = 0; right < 2; right++)
+					ends[end_hash(kmers, contigs[i], right)] = i*2 + right;
+
+		std::vector<size_t> partner(contigs.size()*2, NONE);
+		for (size_t e = 0; e < partner.size(); e++)
+		{
+			hash_t neighbour;
+			if (contigs[e/2].length() < size_t(kmers.kmer_len) || !neighbour_end(kmers, end_hash(kmers, contigs[e/2], e % 2), &neighbour, min_coverage))
+				continue;
+
+			auto it = ends.find(neighbour);
+			if (it != ends.end() && it->second/2 != e/2)
+				partner[e] = it->second;
+		}
+
+		for (size_t e = 0; e < partner.size(); e++)
+			if (partner[e] != NONE && partner[partner[e]] != e)
+				partner[e] = NONE;
+
+		std::list<std::string> stitched;
+		std::vector<bool> done(contigs.size(), false);
+		for (size_t i = 0; i < contigs.size(); i++)
+		{
+			if (done[i])
+				continue;
+
+			// the chain starts at the contig end with no partner, or at contig i for a ring
+			size_t first = i*2;
+			while (partner[first] != NONE && partner[first]/2 != i)
+				first = partner[first] ^ 1;
+
+			stitched.push_back(oriented(contigs[first/2], first % 2));
+			done[first/2] = true;
+			auto &seq = stitched.back();
+			for (size_t e = first ^ 1; partner[e] != NONE && !done[partner[e]/2]; e = partner[e] ^ 1)
+			{
+				seq += oriented(contigs[partner[e]/2], partner[e] % 2).substr(kmers.kmer_len - 1);
+				done[partner[e]/2] = true;
 			}
 		}
+
+		return stitched;
+	}
+
+	static std::string oriented(const std::string &contig, bool reverse)
+	{
+		auto seq = contig;
+		if (reverse)
+			seq_transform_actg::to_rev_complement(seq);
+
+		return seq;
 	}
 
 };
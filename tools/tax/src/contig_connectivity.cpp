@@ -3,18 +3,20 @@
 #include <iomanip>
 #include <ctime>
 #include <omp.h>
-#include <unordered_map>
+#include <algorithm>
+#include <limits>
 #include <vector>
 #include "seq_transform.h"
 #include "fasta.h"
 #include "hash.h"
+#include "kmer_lookup_table.h"
 #include "reader.h"
 #include "config_contig_connectivity.h"
 
 using namespace std;
 using namespace std::chrono;
 
-const string VERSION = "0.10";
+const string VERSION = "0.11";
 
 const int THREADS = 16;
 #define MULTITHREADED 1
@@ -56,7 +58,7 @@ void for_all_reads_do(const string &accession, Lambda &&lambda)
     #pragma omp parallel num_threads(THREADS)
 #endif
     {
-        std::vector<Reader::Fragment> chunk;
+        Reader::Chunk chunk;
         bool done = false;
         while (!done) 
         {
@@ -106,7 +108,89 @@ struct ContigPos
 };
 
 typedef vector<ContigPos> ContigPoss;
-typedef std::unordered_map<hash_t, ContigPoss> ContigMap;
+
+// sorted (kmer, contig, pos) index
+// kmer found in several places has contig = -1 - <first index in repeats>, pos = <number of places>
+struct ContigMap
+{
+    struct KmerPos
+    {
+        hash_t kmer;
+        ContigPos contig_pos;
+
+        KmerPos(hash_t kmer = 0, const ContigPos &contig_pos = ContigPos()) : kmer(kmer), contig_pos(contig_pos){}
+
+        bool operator < (const KmerPos &x) const
+        {
+            return kmer != x.kmer ? kmer < x.kmer : (contig_pos.contig != x.contig_pos.contig ? contig_pos.contig < x.contig_pos.contig : contig_pos.pos < x.contig_pos.pos);
+        }
+    };
+
+    struct Range
+    {
+        const ContigPos *first, *last;
+        Range(const ContigPos *first = nullptr, const ContigPos *last = nullptr) : first(first), last(last){}
+        const ContigPos *begin() const { return first; }
+        const ContigPos *end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+
+    vector<KmerPos> kmers;
+    ContigPoss repeats;
+    KmerLookupTable<hash_t> lookup_table;
+
+    ContigMap(vector<KmerPos> &&all_kmers) : kmers(std::move(all_kmers)), lookup_table(compact(kmers, repeats), KMER_LEN, [](const KmerPos &x) { return x.kmer; })
+    {
+        cerr << "contig map: " << kmers.size() << " kmers, " << repeats.size() << " repeated positions, " << lookup_table.buckets() << " buckets" << endl;
+    }
+
+    static const vector<KmerPos> &compact(vector<KmerPos> &kmers, ContigPoss &repeats)
+    {
+        std::sort(kmers.begin(), kmers.end());
+        size_t unique = 0;
+        for (size_t i = 0; i < kmers.size(); )
+        {
+            size_t same = i + 1;
+            while (same < kmers.size() && kmers[same].kmer == kmers[i].kmer)
+                same++;
+
+            auto contig_pos = kmers[i].contig_pos;
+            if (same - i > 1)
+            {
+                contig_pos = ContigPos(-1 - int(repeats.size()), int(same - i));
+                for (size_t j = i; j < same; j++)
+                    repeats.push_back(kmers[j].contig_pos);
+            }
+
+            kmers[unique] = KmerPos(kmers[i].kmer, contig_pos);
+
+            unique++;
+            i = same;
+        }
+
+        kmers.resize(unique);
+        kmers.shrink_to_fit();
+        repeats.shrink_to_fit();
+        return kmers;
+    }
+
+    Range find(hash_t hash) const
+    {
+        auto bucket = lookup_table.range(hash);
+        auto first = kmers.begin() + bucket.first;
+        auto last = kmers.begin() + bucket.second;
+        first = std::lower_bound(first, last, KmerPos(hash, ContigPos(std::numeric_limits<int>::min(), 0)));
+        if (first == last || first->kmer != hash)
+            return Range();
+
+        auto &contig_pos = first->contig_pos;
+        if (contig_pos.contig >= 0)
+            return Range(&contig_pos, &contig_pos + 1);
+
+        auto repeat = &repeats[-1 - contig_pos.contig];
+        return Range(repeat, repeat + contig_pos.pos);
+    }
+};
 
 
 struct Connect
@@ -118,19 +202,27 @@ struct Connect
     Connect(const ContigPos &contig_pos, int len) : contig_pos(contig_pos), len(len){}
 };
 
-void load_contig_map(const Contigs &contigs, ContigMap &contig_map)
+vector<ContigMap::KmerPos> load_contig_kmers(const Contigs &contigs)
 {
+    size_t total = 0;
+    for (auto &contig : contigs)
+        total += contig.seq.size();
+
+    vector<ContigMap::KmerPos> kmers;
+    kmers.reserve(total);
     for (int contig = 0; contig < contigs.size(); contig++)
     {
         int pos = 0;
         Hash<hash_t>::for_all_hashes_do(contigs[contig].seq, KMER_LEN, [&](hash_t hash)
         {
             hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-            contig_map[hash].push_back(ContigPos(contig, pos));
+            kmers.push_back(ContigMap::KmerPos(hash, ContigPos(contig, pos)));
             pos++;
             return true;
         });
     }
+
+    return kmers;
 }
 
 int pos_distance(const ContigPos &a, const ContigPos &b)
@@ -156,46 +248,28 @@ struct Conn
 {
     int len = 0;
     Conn() = default;
-};
-
-typedef vector<Conn> Connectivity;
-typedef vector<Connectivity> Connectivities;
 
-struct ConnectivitiesMT
-{
-    vector<Connectivities> conn_per_thread;
-
-    ConnectivitiesMT(const Contigs &contigs) : conn_per_thread(THREADS)
+    int update(int new_len) // atomic len = max(len, new_len), returns the result
     {
-        // todo: if (max threads is 0, resize to 1)
-        for (auto &conns : conn_per_thread)
-        {
-            conns.resize(contigs.size());
-            for (int i = 0; i < contigs.size(); i++)
-                conns[i].resize(contigs[i].seq.size());
-        }
-    }
+        int current = __atomic_load_n(&len, __ATOMIC_RELAXED);
+        while (current < new_len && !__atomic_compare_exchange_n(&len, &current, new_len, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
 
-    Connectivities reduce()
-    {
-        for (int thread_i = 1; thread_i < conn_per_thread.size(); thread_i++)
-            for (int seq = 0; seq < conn_per_thread[thread_i].size(); seq++)
-                for (int pos = 0; pos < conn_per_thread[thread_i][seq].size(); pos++)
-                    conn_per_thread[0][seq][pos].len = std::max(conn_per_thread[0][seq][pos].len, conn_per_thread[thread_i][seq][pos].len);
-        
-        return conn_per_thread[0];
+        return std::max(current, new_len);
     }
+};
 
-    Connectivities &get()
-    {
-        int thread_id = omp_get_thread_num();
-        if (thread_id < 0 || thread_id >= conn_per_thread.size())
-            throw std::runtime_error("thread_id < 0 || thread_id >= conn_per_thread.size()");
+typedef vector<Conn> Connectivity;
+typedef vector<Connectivity> Connectivities; // shared by all threads
 
-        return conn_per_thread[thread_id];
-    }
+Connectivities create_connectivities(const Contigs &contigs)
+{
+    Connectivities conns(contigs.size());
+    for (int i = 0; i < contigs.size(); i++)
+        conns[i].resize(contigs[i].seq.size());
 
-};
+    return conns;
+}
 
 Connect connect(Connectivity &conn, const ContigPos &start_pos, const ContigPos &end_pos)
 {
@@ -203,10 +277,7 @@ Connect connect(Connectivity &conn, const ContigPos &start_pos, const ContigPos
         throw std::runtime_error("conn.size() <= start_pos.pos || conn.size() <= end_pos.pos");
 
     if (end_pos.pos >= start_pos.pos)
-    {
-        conn[start_pos.pos].len = std::max(conn[start_pos.pos].len, end_pos.pos - start_pos.pos + KMER_LEN);
-        return Connect(start_pos, conn[start_pos.pos].len);
-    }
+        return Connect(start_pos, conn[start_pos.pos].update(end_pos.pos - start_pos.pos + KMER_LEN));
     else
         return connect(conn, end_pos, start_pos);        
 }
@@ -216,7 +287,7 @@ bool looks_like_paired_read_distance(int a, int b) // todo: use statistics
     return std::abs(a - b) < 1000; // todo: think
 }
 
-void connect_spot(ConnectivitiesMT &conns, const Connect &read1_connect, const Connect &read2_connect)
+void connect_spot(Connectivities &conns, const Connect &read1_connect, const Connect &read2_connect)
 {
     if (read1_connect.len <= 0 || read2_connect.len <= 0)
         return;
@@ -227,18 +298,18 @@ void connect_spot(ConnectivitiesMT &conns, const Connect &read1_connect, const C
     if (!looks_like_paired_read_distance(read2_connect.contig_pos.pos, read1_connect.contig_pos.pos))
         return;
 
-    if (read1_connect.contig_pos.contig < 0 || read1_connect.contig_pos.contig >= conns.get().size())
-        throw std::runtime_error("read1_connect.contig_pos.contig < 0 || read1_connect.contig_pos.contig >= conns.get().size()");
+    if (read1_connect.contig_pos.contig < 0 || read1_connect.contig_pos.contig >= conns.size())
+        throw std::runtime_error("read1_connect.contig_pos.contig < 0 || read1_connect.contig_pos.contig >= conns.size()");
 
-    auto &conn = conns.get()[read1_connect.contig_pos.contig];
+    auto &conn = conns[read1_connect.contig_pos.contig];
 
     if (read2_connect.contig_pos.pos >= read1_connect.contig_pos.pos)
-        conn[read1_connect.contig_pos.pos].len = std::max(conn[read1_connect.contig_pos.pos].len, read2_connect.contig_pos.pos - read1_connect.contig_pos.pos + read2_connect.len);
+        conn[read1_connect.contig_pos.pos].update(read2_connect.contig_pos.pos - read1_connect.contig_pos.pos + read2_connect.len);
     else
         connect_spot(conns, read2_connect, read1_connect);
 }
 
-Connect update_connectivity(const ContigPos &start_pos, int read_start_pos, const string &rev_complement, ConnectivitiesMT &conns, const ContigMap &contig_map)
+Connect update_connectivity(const ContigPos &start_pos, int read_start_pos, const string &rev_complement, Connectivities &conns, const ContigMap &contig_map)
 {
     int pos = 0;
     Connect connect_result;
@@ -246,14 +317,12 @@ Connect update_connectivity(const ContigPos &start_pos, int read_start_pos, cons
     Hash<hash_t>::for_all_hashes_do(rev_complement, KMER_LEN, [&](hash_t hash)
     {
         hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-        auto contig_poss = contig_map.find(hash);
-        if (contig_poss != contig_map.end())
-            for (auto &end_pos : contig_poss->second)
-                if (end_pos.contig == start_pos.contig && about_the_same(pos_distance(end_pos, start_pos), read_distance(read_start_pos, pos, rev_complement.size())))
-                {
-                    connect_result = connect(conns.get()[start_pos.contig], start_pos, end_pos);
-                    return false;
-                }
+        for (auto &end_pos : contig_map.find(hash))
+            if (end_pos.contig == start_pos.contig && about_the_same(pos_distance(end_pos, start_pos), read_distance(read_start_pos, pos, rev_complement.size())))
+            {
+                connect_result = connect(conns[start_pos.contig], start_pos, end_pos);
+                return false;
+            }
 
         pos++;
         return pos < rev_complement.size()/2 - KMER_LEN;
@@ -262,7 +331,7 @@ Connect update_connectivity(const ContigPos &start_pos, int read_start_pos, cons
     return connect_result;
 }
 
-Connect update_connectivity(const string &bases, const string &rev_complement, ConnectivitiesMT &conns, const ContigMap &contig_map)
+Connect update_connectivity(const string &bases, const string &rev_complement, Connectivities &conns, const ContigMap &contig_map)
 {
     Connect connect;
     int pos = 0;
@@ -270,14 +339,12 @@ Connect update_connectivity(const string &bases, const string &rev_complement, C
     Hash<hash_t>::for_all_hashes_do(bases, KMER_LEN, [&](hash_t hash)
     {
         hash = seq_transform<hash_t>::min_hash_variant(hash, KMER_LEN);
-        auto contig_poss = contig_map.find(hash);
-        if (contig_poss != contig_map.end())
-            for (auto &start_pos : contig_poss->second)
-            {
-                connect = update_connectivity(start_pos, pos, rev_complement, conns, contig_map);
-                if (connect.len > 0)
-                    return false; // todo: think
-            }
+        for (auto &start_pos : contig_map.find(hash))
+        {
+            connect = update_connectivity(start_pos, pos, rev_complement, conns, contig_map);
+            if (connect.len > 0)
+                return false; // todo: think
+        }
 
         pos++;
         return pos < bases.size()/2;
@@ -286,7 +353,7 @@ Connect update_connectivity(const string &bases, const string &rev_complement, C
     return connect;
 }
 
-Connect process_contig_connectivity_per_read(const string &bases, ConnectivitiesMT &conns, const ContigMap &contig_map)
+Connect process_contig_connectivity_per_read(const string &bases, Connectivities &conns, const ContigMap &contig_map)
 {
     string rev_complement = bases;
     seq_transform_actg::to_rev_complement(rev_complement);
@@ -298,10 +365,8 @@ Connect process_contig_connectivity_per_read(const string &bases, Connectivities
 
 Connectivities get_contig_connectivity(const Contigs &contigs, const string &accession)
 {
-    ConnectivitiesMT conns(contigs);
-
-    ContigMap contig_map;
-    load_contig_map(contigs, contig_map);
+    auto conns = create_connectivities(contigs);
+    ContigMap contig_map(load_contig_kmers(contigs));
 
     size_t counter = 0;
     for_all_reads_do(accession, [&](const vector<string> &spot)
@@ -317,7 +382,7 @@ Connectivities get_contig_connectivity(const Contigs &contigs, const string &acc
             cerr << ".";
     });
 
-    return conns.reduce();
+    return conns;
 }
 
 void print_connectivity(const Connectivities &conns)
@@ -30,6 +30,7 @@
 #include <chrono>
 #include <vector>
 #include <algorithm>
+#include <memory>
 #include "hash.h"
 #include "seq_transform.h"
 #include "log.h"
@@ -38,8 +39,9 @@ using namespace std;
 typedef uint64_t hash_t;
 
 #include "dbs.h"
+#include "spaced_seed.h"
 
-const string VERSION = "0.22";
+const string VERSION = "0.23";
 
 string reverse_complement(string s) // yes, by value
 {
@@ -47,26 +49,65 @@ string reverse_complement(string s) // yes, by value
     return s;
 }
 
-hash_t hash_of(const string &s)
+// canonical key of a kmer string, K is uint64_t or __uint128_t
+// with spaced seed kmer strings are windows of seed length
+template <class K>
+struct KeyMaker
 {
-	if (!s.size())
-		throw std::runtime_error("invalid string len: 0 ");
+	const string seed;
+	unique_ptr<SpacedKmers<K, uint64_t>> short_seed;
+	unique_ptr<SpacedKmers<K, __uint128_t>> long_seed;
 
-	return Hash<hash_t>::hash_of(s);
-}
+	KeyMaker(const string &seed) : seed(seed)
+	{
+		if (seed.size() > 32)
+			long_seed.reset(new SpacedKmers<K, __uint128_t>(seed));
+		else if (!seed.empty())
+			short_seed.reset(new SpacedKmers<K, uint64_t>(seed));
+	}
+
+	K operator() (const string &s) const
+	{
+		if (!s.size())
+			throw std::runtime_error("invalid string len: 0 ");
+
+		if (!seed.empty() && s.size() != seed.size())
+			throw std::runtime_error("kmer length does not match spaced seed length");
+
+		return std::min(key_of(s), key_of(reverse_complement(s)));
+	}
+
+	K key_of(const string &s) const
+	{
+		if (short_seed)
+			return short_seed->key_of(s);
+
+		if (long_seed)
+			return long_seed->key_of(s);
+
+		return Hash<K>::hash_of(s);
+	}
+
+	int key_len(int kmer_len) const
+	{
+		return seed.empty() ? kmer_len : int(std::count(seed.begin(), seed.end(), '1'));
+	}
+};
 
-void process_without_taxonomy(const string &fasta_db, const string &out_file)
+template <class K>
+void process_without_taxonomy(const string &fasta_db, const string &out_file, const string &seed)
 {
 	cout << "process without taxonomy info" << endl;
 	TextLoaderSTNoStore loader(fasta_db);
-	vector<hash_t> kmers;
+	KeyMaker<K> key_of(seed);
+	vector<K> kmers;
 
 	int kmer_len = 0;
 	{
 		string seq;
 		while (loader.load_next_sequence(seq))
 		{
-			kmers.push_back(std::min( hash_of(seq), hash_of(reverse_complement(seq))));
+			kmers.push_back(key_of(seq));
 			if (!kmer_len)
 				kmer_len = seq.length();
 
@@ -76,21 +117,17 @@ void process_without_taxonomy(const string &fasta_db, const string &out_file)
 	}
 
 	sort(kmers.begin(), kmers.end());
-	DBSIO::save_dbs(out_file, kmers, kmer_len);
-}
-
-typedef DBS::KmerTax KmerTax;
-
-bool kmer_less(const KmerTax &a, const KmerTax &b)
-{
-	return a.kmer < b.kmer;
+	DBSIO::save_dbs(out_file, kmers, DBSIO::Format(key_of.key_len(kmer_len), sizeof(K), seed));
 }
 
-void process_with_taxonomy(const string &fasta_db, const string &out_file)
+template <class K>
+void process_with_taxonomy(const string &fasta_db, const string &out_file, const string &seed)
 {
 	cout << "process with taxonomy info" << endl;
 
+	typedef DBS::KmerTaxOf<K> KmerTax;
 	FastaWithTaxonomyLoader loader(fasta_db);
+	KeyMaker<K> key_of(seed);
 	vector<KmerTax> kmers;
 	int kmer_len = 0;
 
@@ -99,7 +136,7 @@ void process_with_taxonomy(const string &fasta_db, const string &out_file)
 		int tax_id;
 		while (loader.load_next_sequence(seq, tax_id))
 		{
-			kmers.push_back(KmerTax(std::min( hash_of(seq), hash_of(reverse_complement(seq))), tax_id));
+			kmers.push_back(KmerTax(key_of(seq), tax_id));
 			if (!kmer_len)
 				kmer_len = seq.length();
 
@@ -108,8 +145,8 @@ void process_with_taxonomy(const string &fasta_db, const string &out_file)
 		}
 	}
 
-	sort(kmers.begin(), kmers.end(), kmer_less);
-	DBSIO::save_dbs(out_file, kmers, kmer_len);
+	sort(kmers.begin(), kmers.end(), [](const KmerTax &a, const KmerTax &b) { return a.kmer < b.kmer; });
+	DBSIO::save_dbs(out_file, kmers, DBSIO::Format(key_of.key_len(kmer_len), sizeof(K), seed));
 }
 
 bool has_taxonomy_info(const string &filename)
@@ -125,15 +162,33 @@ bool has_taxonomy_info(const string &filename)
 	return seq1.length() != seq2.length();
 }
 
+size_t first_kmer_len(const string &filename)
+{
+	ifstream f(filename);
+	string seq;
+	f >> seq;
+	return seq.length();
+}
+
+template <class K>
+void process(const Config &config)
+{
+	if (has_taxonomy_info(config.fasta_db))
+		process_with_taxonomy<K>(config.fasta_db, config.out_file, config.seed);
+	else
+		process_without_taxonomy<K>(config.fasta_db, config.out_file, config.seed);
+}
+
 int main(int argc, char const *argv[])
 {
 	Config config(argc, argv);
 	LOG("db_fasta_to_bin version " << VERSION);
 
-	if (has_taxonomy_info(config.fasta_db))
-		process_with_taxonomy(config.fasta_db, config.out_file);
+	const auto key_len = config.seed.empty() ? first_kmer_len(config.fasta_db) : std::count(config.seed.begin(), config.seed.end(), '1');
+	if (key_len > 32) // 128 bit keys
+		process<__uint128_t>(config);
 	else
-		process_without_taxonomy(config.fasta_db, config.out_file);
+		process<uint64_t>(config);
 
     return 0;
 }
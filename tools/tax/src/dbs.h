@@ -29,30 +29,40 @@
 
 #include "io.h"
 #include <string>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <utility>
+#include <stdint.h>
 
 struct DBS
 {
 	#pragma pack(push)
 	#pragma pack(4)
 
-	struct KmerTax
+	template <class K>
+	struct KmerTaxOf
 	{
-		hash_t kmer;
+		K kmer;
 		int tax_id;
 
-		KmerTax(hash_t kmer = 0, int tax_id = 0) : kmer(kmer), tax_id(tax_id){}
+		KmerTaxOf(K kmer = 0, int tax_id = 0) : kmer(kmer), tax_id(tax_id){}
 	};
 
 	#pragma pack(pop)
 
+	typedef KmerTaxOf<hash_t> KmerTax;
 	typedef std::vector<KmerTax> Kmers;
 };
 
+// version 1: DBSHeader, 64 bit contiguous kmers
+// version 2: DBSHeader, DBSSeedHeader - 128 bit keys and/or spaced seed
+// kmer_len is the number of bases in a key, i.e. the weight of a spaced seed
 struct DBSIO
 {
 	static const int VERSION = 1;
+	static const int SEED_VERSION = 2;
+	static const int MAX_SEED_SPAN = 64;
 
 	struct DBSHeader
 	{
@@ -60,33 +70,118 @@ struct DBSIO
 		DBSHeader(size_t kmer_len = 0) : version(VERSION), kmer_len(kmer_len){}
 	};
 
+	struct DBSSeedHeader
+	{
+		size_t key_bytes;
+		char seed[MAX_SEED_SPAN]; // zero padded, see Format::seed
+	};
+
+	struct Format
+	{
+		size_t kmer_len, key_bytes;
+		std::string seed; // '1' - base is a part of the key, '0' - skipped, empty for contiguous kmers
+
+		Format(size_t kmer_len = 0, size_t key_bytes = sizeof(uint64_t), const std::string &seed = std::string()) : kmer_len(kmer_len), key_bytes(key_bytes), seed(seed){}
+
+		bool is_contiguous() const { return seed.empty(); }
+		size_t version() const { return key_bytes == sizeof(uint64_t) && is_contiguous() ? VERSION : SEED_VERSION; }
+		size_t header_size() const { return sizeof(DBSHeader) + (version() == VERSION ? 0 : sizeof(DBSSeedHeader)); }
+	};
+
+	// key size of hash or KmerTax like element
+	template <class C>
+	static auto key_bytes(int) -> decltype(sizeof(std::declval<C>().kmer)) { return sizeof(std::declval<C>().kmer); }
+
+	template <class C>
+	static size_t key_bytes(long) { return sizeof(C); }
+
 	template <class C>
 	static void save_dbs(const std::string &out_file, const std::vector<C> &kmers, size_t kmer_len)
 	{
+		save_dbs(out_file, kmers, Format(kmer_len, key_bytes<C>(0)));
+	}
+
+	template <class C>
+	static void save_dbs(const std::string &out_file, const std::vector<C> &kmers, const Format &format)
+	{
+		if (format.key_bytes != key_bytes<C>(0))
+			throw std::runtime_error("save_dbs:: key size does not match format");
+
 		std::ofstream f(out_file);
-		DBSHeader header(kmer_len);
-        IO::write(f, header);
+		save_format(f, format);
         IO::save_vector(f, kmers);
 	}
 
+	static void save_format(std::ofstream &f, const Format &format)
+	{
+		DBSHeader header(format.kmer_len);
+		header.version = format.version();
+        IO::write(f, header);
+		if (header.version == SEED_VERSION)
+		{
+			if (format.seed.size() > MAX_SEED_SPAN)
+				throw std::runtime_error("save_dbs:: seed is too long");
+
+			DBSSeedHeader seed_header;
+			memset(&seed_header, 0, sizeof(seed_header));
+			seed_header.key_bytes = format.key_bytes;
+			memcpy(seed_header.seed, format.seed.data(), format.seed.size());
+			IO::write(f, seed_header);
+		}
+	}
+
+	static Format load_format(std::ifstream &f)
+	{
+        DBSHeader header;
+        IO::read(f, header);
+		if (header.version != VERSION && header.version != SEED_VERSION)
+			throw std::runtime_error("unsupported dbs file version");
+
+		Format format(header.kmer_len);
+		if (header.version == SEED_VERSION)
+		{
+			DBSSeedHeader seed_header;
+			IO::read(f, seed_header);
+			format.key_bytes = seed_header.key_bytes;
+			format.seed.assign(seed_header.seed, strnlen(seed_header.seed, MAX_SEED_SPAN));
+		}
+
+		if (format.kmer_len < 1 || format.kmer_len > format.key_bytes * 4)
+			throw std::runtime_error("load_dbs:: invalid kmer_len");
+
+		return format;
+	}
+
+	static Format load_format(const std::string &filename)
+	{
+    	std::ifstream f(filename, std::ios::binary | std::ios::in);
+	    if (f.fail() || f.eof())
+		    throw std::runtime_error(std::string("cannot load dbs ") + filename);
+
+		return load_format(f);
+	}
+
+	// without format only contiguous kmers are accepted
 	template <class C>
-	static size_t load_dbs(const std::string &filename, std::vector<C> &kmers)
+	static size_t load_dbs(const std::string &filename, std::vector<C> &kmers, Format *format = nullptr)
 	{
     	std::ifstream f(filename, std::ios::binary | std::ios::in);
 	    if (f.fail() || f.eof())
 		    throw std::runtime_error(std::string("cannot load dbs ") + filename);
 
-        DBSHeader header;
-        IO::read(f, header);
-		if (header.version != VERSION)
-			throw std::runtime_error("unsupported dbs file version");
+		auto file_format = load_format(f);
+		if (file_format.key_bytes != key_bytes<C>(0))
+			throw std::runtime_error("load_dbs:: unsupported key size " + std::to_string(file_format.key_bytes * 8) + " bits");
+
+		if (!format && !file_format.is_contiguous())
+			throw std::runtime_error("load_dbs:: spaced seed dbs are not supported here");
 
         IO::load_vector(f, kmers);
 
-		if (header.kmer_len < 1 || header.kmer_len > 64)
-			throw std::runtime_error("load_dbs:: invalid kmer_len");
+		if (format)
+			*format = file_format;
 
-		return header.kmer_len;
+		return file_format.kmer_len;
 	}
 };
 
@@ -1,7 +1,8 @@
 #include <string>
 #include <fstream>
 #include <vector>
-#include <list>
+#include <map>
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <chrono>
@@ -17,6 +18,7 @@ typedef uint64_t hash_t;
 #include "config_fasta_contamination.h"
 #include "seq_transform.h"
 #include "file_list_loader.h"
+#include "kmer_lookup_table.h"
 
 struct KmerTax : public DBS::KmerTax
 {
@@ -31,18 +33,34 @@ struct KmerTax : public DBS::KmerTax
 using namespace std;
 using namespace std::chrono;
 
-const string VERSION = "0.10";
+const string VERSION = "0.11";
 
 typedef int tax_t;
 typedef vector<KmerTax> HashSortedArray;
 
-tax_t find_hash(hash_t hash, tax_t default_value, HashSortedArray &hash_array)
+// read-only database shared by all threads
+struct KmerDB
 {
-    auto first = hash_array.begin();
-    auto last = hash_array.end();
-    first = std::lower_bound(first, last, KmerTax(hash, 0));
-    return ((first == last) || (hash < first->kmer) ) ? default_value : first->tax_id;
-}
+    HashSortedArray hash_array;
+    int kmer_len;
+    KmerLookupTable<hash_t> lookup_table;
+
+    KmerDB(const string &dbs) : 
+        kmer_len(int(DBSIO::load_dbs(dbs, hash_array))),
+        lookup_table(hash_array, kmer_len, [](const KmerTax &x) { return x.kmer; })
+    {
+        LOG("db kmers: " << hash_array.size() << ", kmer len: " << kmer_len << ", lookup buckets: " << lookup_table.buckets());
+    }
+
+    tax_t find_hash(hash_t hash, tax_t default_value) const
+    {
+        auto bucket = lookup_table.range(hash);
+        auto first = hash_array.begin() + bucket.first;
+        auto last = hash_array.begin() + bucket.second;
+        first = std::lower_bound(first, last, KmerTax(hash, 0));
+        return ((first == last) || (hash < first->kmer) ) ? default_value : first->tax_id;
+    }
+};
 
 struct Hit
 {
@@ -51,54 +69,61 @@ struct Hit
     Hit(int pos, tax_t tax_id) : pos(pos), tax_id(tax_id){}
 };
 
-typedef std::list<Hit> Hits;
+typedef std::vector<Hit> Hits;
 
 struct SeqContamination
 {
     string desc;
     Hits hits;
-    SeqContamination(const string &desc, const Hits &hits) : desc(desc), hits(hits){}
+    SeqContamination(const string &desc, Hits &&hits) : desc(desc), hits(std::move(hits)){}
 };
 
-typedef std::list<SeqContamination> SeqContaminations;
+typedef std::vector<SeqContamination> SeqContaminations;
 
 struct Contamination
 {
     string filename;
-    SeqContaminations seqs;
+    SeqContaminations seqs; // empty in summary mode
     int total_hits;
+    int contaminated_seqs;
+    map<tax_t, int> tax_hits;
 
-    Contamination(const string &filename) : filename(filename), total_hits(0){}
+    Contamination(const string &filename) : filename(filename), total_hits(0), contaminated_seqs(0){}
 
     bool operator <(const Contamination &x) const
     {
         return total_hits > x.total_hits;
     }
 
-    void add(const SeqContamination &seq)
+    void add(const string &desc, Hits &hits, bool keep_hits)
     {
-        seqs.push_back(seq);
-        total_hits += seq.hits.size();
+        total_hits += hits.size();
+        contaminated_seqs++;
+        for (auto &h : hits)
+            tax_hits[h.tax_id]++;
+
+        if (keep_hits)
+            seqs.push_back(SeqContamination(desc, std::move(hits)));
     }
 };
 
-Contamination check_for_contamination(const string &filename, int kmer_len, HashSortedArray &hash_array)
+Contamination check_for_contamination(const string &filename, const KmerDB &db, bool keep_hits)
 {
     Fasta fasta(filename);
     
     Contamination result(filename);
 
     string seq;
+    Hits hits;
     while (fasta.get_next_sequence(seq))
     {
-        string desc = fasta.sequence_description();
-        Hits hits;
+        hits.clear();
 
         int pos = 0;
-        Hash<hash_t>::for_all_hashes_do(seq, kmer_len, [&](hash_t hash)
+        Hash<hash_t>::for_all_hashes_do(seq, db.kmer_len, [&](hash_t hash)
         {
-			hash = seq_transform<hash_t>::min_hash_variant(hash, kmer_len);
-            auto tax_id = find_hash(hash, 0, hash_array);
+			hash = seq_transform<hash_t>::min_hash_variant(hash, db.kmer_len);
+            auto tax_id = db.find_hash(hash, 0);
             if (tax_id)
                 hits.push_back(Hit(pos, tax_id));
 
@@ -107,7 +132,7 @@ Contamination check_for_contamination(const string &filename, int kmer_len, Hash
         });
 
         if (!hits.empty())
-            result.add(SeqContamination(desc, hits));
+            result.add(fasta.sequence_description(), hits, keep_hits);
     }    
 
     return result;
@@ -126,6 +151,21 @@ void print(const Contamination &r)
     }
 }
 
+void print_summary(const Contamination &r)
+{
+    vector<pair<int, tax_t>> taxes;
+    for (auto &t : r.tax_hits)
+        taxes.push_back(make_pair(t.second, t.first));
+
+    std::sort(taxes.begin(), taxes.end(), [](const pair<int, tax_t> &a, const pair<int, tax_t> &b) { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+
+    cout << r.filename << '\t' << r.total_hits << '\t' << r.contaminated_seqs << '\t';
+    for (size_t i = 0; i < taxes.size(); i++)
+        cout << (i ? "," : "") << taxes[i].second << ':' << taxes[i].first;
+
+    cout << endl;
+}
+
 int main(int argc, char const *argv[])
 {
 	Config config(argc, argv);
@@ -133,35 +173,41 @@ int main(int argc, char const *argv[])
 	auto before = high_resolution_clock::now();
 
 	FileListLoader file_list(config.file_list);
+    // largest files first, so the slowest ones do not end up last
+    std::stable_sort(file_list.files.begin(), file_list.files.end(), [](const FileListLoader::File &a, const FileListLoader::File &b) { return a.filesize > b.filesize; });
+
+	KmerDB db(config.dbs);
 
-	HashSortedArray hash_array;
-	int kmer_len = DBSIO::load_dbs(config.dbs, hash_array);
+    if (config.threads > 0)
+        omp_set_num_threads(config.threads);
 
-    const int THREADS = 48;
-    list<Contamination> contaminations; // todo: list ?
+    vector<vector<Contamination>> contaminations_per_thread(std::max(1, omp_get_max_threads()));
+    LOG("threads: " << contaminations_per_thread.size() << ", files: " << file_list.files.size());
 
-	#pragma omp parallel num_threads(THREADS) 
-	for (int i = omp_get_thread_num(); i < file_list.files.size(); i += omp_get_num_threads())
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < int(file_list.files.size()); i++)
 	{
-        auto file_list_element = file_list.files[i];
-		auto contamination = check_for_contamination(file_list_element.filename, kmer_len, hash_array);
+        auto &file_list_element = file_list.files[i];
+		auto contamination = check_for_contamination(file_list_element.filename, db, !config.summary);
+        #pragma omp critical (log)
+        LOG(contamination.total_hits << "\thits\t" << file_list_element.filename);
 
-        #pragma omp critical (read)
-        {
-		    LOG(contamination.total_hits << "\thits\t" << file_list_element.filename);
-            if (contamination.total_hits > 0)
-                contaminations.push_back(contamination);
-//            if (contamination.total_hits > 0)
-//                print(contamination);
-        }
+        if (contamination.total_hits > 0)
+            contaminations_per_thread[omp_get_thread_num()].push_back(std::move(contamination));
 	}
 
-//    std::sort(contaminations.begin(), contaminations.end());
-//    cout << "sorted:" << endl;
-    contaminations.sort();
+    vector<Contamination> contaminations;
+    for (auto &thread_contaminations : contaminations_per_thread)
+        for (auto &c : thread_contaminations)
+            contaminations.push_back(std::move(c));
+
+    std::stable_sort(contaminations.begin(), contaminations.end());
 
     for (auto &r : contaminations)
-        print(r);
+        if (config.summary)
+            print_summary(r);
+        else
+            print(r);
 
 	LOG("total time (min) " << std::chrono::duration_cast<std::chrono::minutes>( high_resolution_clock::now() - before ).count());
 }
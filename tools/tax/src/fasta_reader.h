@@ -39,6 +39,12 @@ private:
     size_t fsize;
     size_t spot_idx;
     std::string last_desc;
+    bool has_desc; // last_desc is not consumed yet
+    size_t offset; // of the next line
+    size_t desc_offset; // of last_desc
+    size_t range_end;
+    bool ranged;
+    std::string line_buf; // reused by read() to avoid per read allocations
 
     static bool is_description(const std::string &s)
 	{
@@ -47,12 +53,29 @@ private:
 
     void read_line(std::string& line) {
         std::getline(f, line);
+        offset += line.size() + 1;
         // handling windows line endings
         if (!line.empty() && *line.rbegin() == '\r') {
             line.erase(line.size() - 1);
         }
     }
 
+    // reads lines up to the next description
+    void next_description() {
+        std::string line;
+        has_desc = false;
+        while (!f.eof()) {
+            const size_t line_offset = offset;
+            read_line(line);
+            if (is_description(line)) {
+                last_desc = line;
+                desc_offset = line_offset;
+                has_desc = true;
+                break;
+            }
+        }
+    }
+
     static bool ends_with(const std::string &s, const std::string &end)
     {
         if (end.size() > s.size()) 
@@ -69,6 +92,11 @@ public:
 	FastaReader(const std::string &filename)
         : f(filename, std::ios::binary)
         , spot_idx(0)
+        , has_desc(false)
+        , offset(0)
+        , desc_offset(0)
+        , range_end(size_t(-1))
+        , ranged(false)
 	{
         f.seekg(0, std::ios::end);
         fsize = f.tellg();
@@ -84,12 +112,43 @@ public:
 			throw std::runtime_error("this is not a fasta file");
 
 		last_desc = line;
+        has_desc = true;
 	}
 
     size_t file_size() const { return fsize; }
 
+    // seekable reader interface, see MTReader
+    // range is in bytes, reader returns records with description starting in [first, first + count)
+    size_t range_units() const { return fsize; }
+
+    void set_range(size_t first, size_t count) {
+        ranged = true;
+        range_end = first + count;
+        f.clear();
+        if (first == 0) {
+            f.seekg(0, std::ios::beg);
+            offset = 0;
+        } else {
+            // resync: skipping the rest of the line containing first - 1
+            f.seekg(first - 1, std::ios::beg);
+            offset = first - 1;
+            std::string line;
+            read_line(line);
+        }
+        next_description();
+    }
+
+    static SourceStats merge_range_stats(const std::vector<SourceStats>& stats) {
+        SourceStats total;
+        for (auto& s: stats) {
+            total.spot_count += s.spot_count;
+        }
+        total.expected_spot_count = total.spot_count;
+        return total;
+    }
+
     virtual SourceStats stats() const override {
-        assert(f.eof());
+        assert(ranged || f.eof());
         return SourceStats(spot_idx);
     }
     
@@ -102,25 +161,27 @@ public:
     }
 
     bool read(Fragment* output) override {
-        if (f.eof()) {
+        if (!has_desc || desc_offset >= range_end) {
             return false;
         }
 
         if (output) {
             output->spotid.assign(last_desc, 1, last_desc.size() - 1);
             output->bases.clear();
-            output->bases.reserve(10000); // todo: tune
         }
 
-		std::string line;
+        has_desc = false;
 		while (!f.eof()) {
-            read_line(line);
+            const size_t line_offset = offset;
+            read_line(line_buf);
 
-            if (is_description(line)) {
-                last_desc = line;
+            if (is_description(line_buf)) {
+                last_desc = line_buf;
+                desc_offset = line_offset;
+                has_desc = true;
                 break;
             } else if (output) {
-                output->bases += line;
+                output->bases += line_buf;
             }
         }
 
@@ -128,10 +189,8 @@ public:
             if (output->bases.empty()) {
                 throw std::runtime_error("Read is empty");
             }
-            output->bases.shrink_to_fit();
         }
         ++spot_idx;
         return true;
     }
 };
-
@@ -5,14 +5,17 @@
 #include "reader.h"
 #include "vdb_reader.h"
 #include "log.h"
+#include "bloom_filter.h"
 
 struct KmerLoader
 {
 	KmerMap32 &kmers;
     Reader::Params reader_params;
+	int bloom_filter_mb; // 0 - single pass loading
 
-	KmerLoader(KmerMap32 &kmers, bool unaligned_only, const std::string& filter_file, bool exclude_filter) : 
-		kmers(kmers)
+	KmerLoader(KmerMap32 &kmers, bool unaligned_only, const std::string& filter_file, bool exclude_filter, int bloom_filter_mb = 0) : 
+		kmers(kmers),
+		bloom_filter_mb(bloom_filter_mb)
     {
         reader_params.filter_file = filter_file;
         reader_params.exclude_filter = exclude_filter;
@@ -25,6 +28,7 @@ struct KmerLoader
 		auto before = std::chrono::high_resolution_clock::now();
         load_32(accession);
 		LOG("loading total time is (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - before ).count());
+		LOG("peak mem usage " << peak_mem_usage()/1000000 << "M");
 	}
 
 	template <class hash_t>
@@ -36,7 +40,10 @@ struct KmerLoader
 	void load_32(const std::string &accession)
 	{
 		auto before = std::chrono::high_resolution_clock::now();
-		load_min_mem_map<KmerMap32>(accession, kmers, NoCheck<KmerMap32::hash_t>());
+		if (bloom_filter_mb > 0)
+			load_two_pass<KmerMap32>(accession, kmers);
+		else
+			load_min_mem_map<KmerMap32>(accession, kmers, NoCheck<KmerMap32::hash_t>());
 		LOG("32mer loading time is (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - before ).count());
 		LOG("32mer real size: " << kmers.size());
 
@@ -50,13 +57,69 @@ struct KmerLoader
 
 	template <class KmerMap, class Predicate>
 	void load_min_mem_map(const std::string &accession, KmerMap &kmers, Predicate pred)
+	{
+		for_all_kmers_do<typename KmerMap::hash_t>(accession, kmers.kmer_len, [&](typename KmerMap::hash_t hash)
+			{
+				if (pred(hash))
+					kmers.add(hash);
+			});
+	}
+
+	// kmers of the accession, once per call
+	template <class hash_t>
+	struct AccessionKmers
+	{
+		KmerLoader &loader;
+		const std::string &accession;
+		int kmer_len;
+
+		template <class Lambda>
+		void operator () (Lambda &&on_kmer)
+		{
+			loader.for_all_kmers_do<hash_t>(accession, kmer_len, on_kmer);
+		}
+	};
+
+	template <class KmerMap>
+	void load_two_pass(const std::string &accession, KmerMap &kmers)
+	{
+		load_two_pass(kmers, bloom_filter_mb, AccessionKmers<typename KmerMap::hash_t>{*this, accession, kmers.kmer_len});
+	}
+
+	// first pass: only kmers seen at least twice (or bloom filter false positives) get into the map
+	// second pass: exact counts for kmers in the map, optimize() drops false positives
+	// for_all_kmers(on_kmer) calls on_kmer(hash) for every kmer of the input, it is called once per pass
+	template <class KmerMap, class ForAllKmers>
+	static void load_two_pass(KmerMap &kmers, int bloom_filter_mb, ForAllKmers &&for_all_kmers)
+	{
+		typedef typename KmerMap::hash_t hash_t;
+		{
+			auto before = std::chrono::high_resolution_clock::now();
+			BloomFilter<hash_t> seen(size_t(bloom_filter_mb) * 1024 * 1024);
+			for_all_kmers([&](hash_t hash)
+				{
+					if (seen.add(seq_transform<hash_t>::min_hash_variant(hash, kmers.kmer_len)))
+						kmers.add_key(hash);
+				});
+
+			LOG("bloom filter pass time is (ms) " << std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - before ).count());
+			LOG("bloom filter size " << seen.size_in_bytes()/1000000 << "M, fill ratio " << seen.fill_ratio());
+			LOG("repeated kmer candidates: " << kmers.size());
+			LOG("mem usage " << mem_usage()/1000000000 << "G");
+		}
+
+		for_all_kmers([&](hash_t hash) { kmers.add_existing(hash); });
+	}
+
+	template <class hash_t, class Lambda>
+	void for_all_kmers_do(const std::string &accession, int kmer_len, Lambda &&on_kmer)
 	{
         auto reader = Reader::create(accession, reader_params);
 
         const int THREADS = 4;
         #pragma omp parallel num_threads(THREADS)
         {
-            std::vector<Reader::Fragment> chunk;
+            Reader::Chunk chunk;
             bool done = false;
             while (!done) 
             {
@@ -67,14 +130,13 @@ struct KmerLoader
 
                 for (auto& frag: chunk) 
                 {
-                    auto lambda = [&](typename KmerMap::hash_t hash) 
+                    auto lambda = [&](hash_t hash) 
                     {
-                        if (pred(hash))
-                            kmers.add(hash);
+                        on_kmer(hash);
                         return true;
                     };
 
-                    Hash<typename KmerMap::hash_t>::for_all_hashes_do(frag.bases, kmers.kmer_len, lambda);
+                    Hash<hash_t>::for_all_hashes_do(frag.bases, kmer_len, lambda);
                 }
             }
         }
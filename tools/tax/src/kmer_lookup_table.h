@@ -0,0 +1,53 @@
+#ifndef KMER_LOOKUP_TABLE_H_INCLUDED
+#define KMER_LOOKUP_TABLE_H_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+// prefix bucket index over an array sorted by kmer, same idea as DBSJob::Matcher lookup table
+// range(hash) narrows binary search to the few elements sharing the top bits of the kmer
+template <class hash_t>
+struct KmerLookupTable
+{
+	std::vector<size_t> bucket_starts; // bucket i is [bucket_starts[i], bucket_starts[i + 1])
+	int shift;
+
+	template <class SortedArray, class GetKmer>
+	KmerLookupTable(const SortedArray &sorted, int kmer_len, GetKmer &&get_kmer, size_t hashes_per_bucket = 5)
+	{
+		int lookup_key_bits = 1;
+		while ((sorted.size() >> lookup_key_bits) > hashes_per_bucket && lookup_key_bits < kmer_len * 2)
+			lookup_key_bits++;
+
+		shift = kmer_len * 2 - lookup_key_bits;
+		const size_t bucket_count = size_t(1) << lookup_key_bits;
+		bucket_starts.resize(bucket_count + 1);
+
+		size_t i = 0;
+		for (size_t bucket = 0; bucket < bucket_count; bucket++)
+		{
+			bucket_starts[bucket] = i;
+			while (i < sorted.size() && size_t(get_kmer(sorted[i]) >> shift) == bucket)
+				i++;
+		}
+
+		if (i != sorted.size())
+			throw std::runtime_error("KmerLookupTable: array is not sorted by kmer");
+
+		bucket_starts[bucket_count] = i;
+	}
+
+	size_t buckets() const
+	{
+		return bucket_starts.size() - 1;
+	}
+
+	std::pair<size_t, size_t> range(hash_t hash) const
+	{
+		auto bucket = size_t(hash >> shift);
+		return std::make_pair(bucket_starts[bucket], bucket_starts[bucket + 1]);
+	}
+};
+
+#endif
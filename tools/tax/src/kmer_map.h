@@ -48,21 +48,32 @@ struct KmerMap
 
 		auto bucket = get_count_bucket(hash);
 		bucket_mutex[bucket].lock(); // todo: try atomic?
-		auto &c = count[bucket][hash];
+		increment(bucket, count[bucket][hash], complement, reverse);
+		bucket_mutex[bucket].unlock();
+	}
 
-		if (c.count == 0)
-		{
-			c.complement = complement;
-			c.reverse = reverse;
-		}
+	// creates zero count entry, for two pass loading
+	void add_key(hash_t hash)
+	{
+		hash = seq_transform<hash_t>::min_hash_variant(hash, kmer_len);
 
-		if (c.count == 1)
-			bucket_frequent[bucket]++;
+		auto bucket = get_count_bucket(hash);
+		bucket_mutex[bucket].lock();
+		count[bucket][hash];
+		bucket_mutex[bucket].unlock();
+	}
 
-		if (c.count < Count::MAX_COUNT)
-			c.count++;
+	// counts only kmers already in the map
+	void add_existing(hash_t hash)
+	{
+		bool complement = false, reverse = false;
+		hash = seq_transform<hash_t>::min_hash_variant(hash, kmer_len, &complement, &reverse);
 
-		bucket_weight[bucket]++;
+		auto bucket = get_count_bucket(hash);
+		bucket_mutex[bucket].lock();
+		auto it = count[bucket].find(hash);
+		if (it != count[bucket].end())
+			increment(bucket, it->second, complement, reverse);
 		bucket_mutex[bucket].unlock();
 	}
 
@@ -94,7 +105,9 @@ struct KmerMap
 		if (it == bucket.end())
 			return Count();
 
-		return it->second;
+		Count c;
+		__atomic_load(&it->second, &c, __ATOMIC_RELAXED); // may be claimed concurrently
+		return c;
 	}
 
 	void remove(hash_t hash)
@@ -110,6 +123,31 @@ struct KmerMap
 		it->second.deleted = 1;
 	}
 
+	// atomically sets deleted bit, returns false if the kmer is missing or already deleted
+	// safe to call from many threads as long as nobody adds kmers at the same time
+	bool claim(hash_t hash)
+	{
+		hash = seq_transform<hash_t>::min_hash_variant(hash, kmer_len);
+
+		auto &bucket = count[get_count_bucket(hash)];
+		auto it = bucket.find(hash);
+		if (it == bucket.end())
+			return false;
+
+		auto &c = it->second;
+		Count expected;
+		__atomic_load(&c, &expected, __ATOMIC_RELAXED);
+		while (!expected.deleted)
+		{
+			Count desired = expected;
+			desired.deleted = 1;
+			if (__atomic_compare_exchange(&c, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				return true;
+		}
+
+		return false;
+	}
+
 	void restore(hash_t hash)
 	{
 		bool complement = false, reverse = false;
@@ -212,6 +250,24 @@ struct KmerMap
 				lambda(map_element.first, map_element.second.count);
 	}
 
+private:
+	void increment(unsigned int bucket, Count &c, bool complement, bool reverse)
+	{
+		if (c.count == 0)
+		{
+			c.complement = complement;
+			c.reverse = reverse;
+		}
+
+		if (c.count == 1)
+			bucket_frequent[bucket]++;
+
+		if (c.count < Count::MAX_COUNT)
+			c.count++;
+
+		bucket_weight[bucket]++;
+	}
+
 };
 
 //typedef KmerMap<__uint128_t, 64, 1024> KmerMap64;
@@ -24,4 +24,23 @@ static unsigned long long int mem_usage()
 #endif
 }
 
+static unsigned long long int peak_mem_usage() // peak resident set size
+{
+#if _WINDOWS
+    return 0;
+#else
+   std::ifstream f("/proc/self/status", std::ios_base::in);
+   std::string x;
+   while (f >> x)
+	   if (x == "VmHWM:")
+	   {
+		   unsigned long long int kb = 0;
+		   f >> kb;
+		   return kb * 1024;
+	   }
+
+   return 0;
+#endif
+}
+
 #endif
@@ -0,0 +1,167 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "mem_usage.h"
+
+// throughput counters
+// every thread counts into its own Metrics::local() without synchronization,
+// Metrics::total() sums all threads up and should be called when counting threads are idle
+struct Metrics {
+    uint64_t reads;
+    uint64_t bases;
+    uint64_t kmers; // hashed
+    uint64_t lookups; // in db
+    uint64_t hits; // lookups found in db
+    uint64_t matched_reads;
+    // nanoseconds, summed over threads
+    uint64_t read_wait_ns; // waiting for other threads to finish reading
+    uint64_t read_ns;
+    uint64_t match_ns;
+    uint64_t print_wait_ns; // waiting for other threads to finish printing
+    uint64_t print_ns;
+
+    Metrics() { clear(); }
+
+    void clear() {
+        reads = bases = kmers = lookups = hits = matched_reads = 0;
+        read_wait_ns = read_ns = match_ns = print_wait_ns = print_ns = 0;
+    }
+
+    void add(const Metrics& x) {
+        reads += x.reads;
+        bases += x.bases;
+        kmers += x.kmers;
+        lookups += x.lookups;
+        hits += x.hits;
+        matched_reads += x.matched_reads;
+        read_wait_ns += x.read_wait_ns;
+        read_ns += x.read_ns;
+        match_ns += x.match_ns;
+        print_wait_ns += x.print_wait_ns;
+        print_ns += x.print_ns;
+    }
+
+    // one json line, times in ms
+    std::string to_json(uint64_t wall_ns = 0) const {
+        std::ostringstream s;
+        s << "{\"reads\":" << reads
+          << ",\"bases\":" << bases
+          << ",\"kmers\":" << kmers
+          << ",\"lookups\":" << lookups
+          << ",\"hits\":" << hits
+          << ",\"matched_reads\":" << matched_reads
+          << ",\"read_wait_ms\":" << read_wait_ns / 1000000
+          << ",\"read_ms\":" << read_ns / 1000000
+          << ",\"match_ms\":" << match_ns / 1000000
+          << ",\"print_wait_ms\":" << print_wait_ns / 1000000
+          << ",\"print_ms\":" << print_ns / 1000000;
+        if (wall_ns) {
+            s << ",\"wall_ms\":" << wall_ns / 1000000
+              << ",\"reads_per_sec\":" << uint64_t(reads * 1e9 / wall_ns);
+        }
+        s << ",\"peak_rss_mb\":" << peak_mem_usage() / 1024 / 1024 << "}";
+        return s.str();
+    }
+
+    static Metrics& local();
+    static Metrics total();
+    static void reset();
+
+    // adds elapsed time to the counter when going out of scope
+    class Timer {
+    private:
+        uint64_t& ns;
+        const std::chrono::high_resolution_clock::time_point start;
+    public:
+        explicit Timer(uint64_t& ns) : ns(ns), start(std::chrono::high_resolution_clock::now()) {}
+        ~Timer() { ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count(); }
+    };
+
+private:
+    struct Registry;
+    struct Local;
+    static Registry& registry();
+};
+
+struct Metrics::Registry {
+    std::mutex mutex;
+    std::vector<Metrics*> live;
+    Metrics finished; // of exited threads
+};
+
+struct Metrics::Local {
+    Metrics metrics;
+    Local() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&metrics);
+    }
+    ~Local() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.finished.add(metrics);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &metrics));
+    }
+};
+
+inline Metrics::Registry& Metrics::registry() {
+    static Registry r;
+    return r;
+}
+
+inline Metrics& Metrics::local() {
+    static thread_local Local instance;
+    return instance.metrics;
+}
+
+inline Metrics Metrics::total() {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Metrics res = r.finished;
+    for (auto m: r.live) {
+        res.add(*m);
+    }
+    return res;
+}
+
+inline void Metrics::reset() {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.finished.clear();
+    for (auto m: r.live) {
+        m->clear();
+    }
+}
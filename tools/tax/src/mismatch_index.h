@@ -0,0 +1,152 @@
+#ifndef MISMATCH_INDEX_H_INCLUDED
+#define MISMATCH_INDEX_H_INCLUDED
+
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <stdexcept>
+#include <algorithm>
+#include "kmer_lookup_table.h"
+#include "seq_transform.h"
+#include "log.h"
+
+// finds db kmers within max_mismatches (hamming distance) of a query kmer, pigeonhole principle:
+// kmer is split into max_mismatches + 1 parts, a kmer with up to max_mismatches mismatches
+// matches at least one part exactly. for every part there is a permutation of the db sorted by that part,
+// so a query costs 2 (both strands) * parts bucket lookups plus verification of candidates sharing a part
+//
+// cost model, for n db kmers:
+// memory - parts * (4 bytes per kmer + lookup table, 8 bytes per ~5 kmers)
+// time per query - 2 * sum over parts of n / 4^part_len candidates, reported by expected_candidates()
+// k = 32: 1 mismatch - 2 parts of 16 bases, practically free; 2 mismatches - 11 bases, n / 2M candidates per part;
+// 3 mismatches - 8 bases, n / 65536 candidates per part, usable for small (tax list restricted) dbs only
+template <class hash_t, class Array>
+struct MismatchIndex
+{
+	typedef uint32_t index_t;
+	static const size_t NONE = size_t(-1);
+	static const int MAX_PARTS = 4;
+
+	struct Part
+	{
+		int shift, len; // bits [shift, shift + 2 * len) of the kmer
+		std::vector<index_t> order; // db indexes sorted by part
+		std::unique_ptr<KmerLookupTable<uint64_t>> lookup_table;
+
+		uint64_t bits_of(hash_t kmer) const
+		{
+			return uint64_t(kmer >> shift) & ((uint64_t(1) << (len * 2 - 1) << 1) - 1);
+		}
+	};
+
+	const Array &sorted;
+	int kmer_len, max_mismatches;
+	std::vector<Part> parts;
+
+	MismatchIndex(const Array &sorted, int kmer_len, int max_mismatches) : sorted(sorted), kmer_len(kmer_len), max_mismatches(max_mismatches), parts(max_mismatches + 1)
+	{
+		if (max_mismatches < 1 || max_mismatches >= MAX_PARTS || kmer_len < 2 * (max_mismatches + 1))
+			throw std::runtime_error("MismatchIndex: invalid number of mismatches");
+
+		if (sorted.size() >= size_t(index_t(-1)))
+			throw std::runtime_error("MismatchIndex: too many kmers");
+
+		int shift = 0;
+		for (int i = 0; i < int(parts.size()); i++)
+		{
+			auto &part = parts[i];
+			part.len = kmer_len / int(parts.size()) + (i < kmer_len % int(parts.size()) ? 1 : 0);
+			part.shift = shift;
+			shift += part.len * 2;
+
+			part.order.resize(sorted.size());
+			for (size_t j = 0; j < sorted.size(); j++)
+				part.order[j] = index_t(j);
+
+			std::sort(part.order.begin(), part.order.end(), [&](index_t a, index_t b)
+				{
+					return part.bits_of(sorted[a].kmer) < part.bits_of(sorted[b].kmer);
+				});
+
+			part.lookup_table.reset(new KmerLookupTable<uint64_t>(part.order, part.len, [&](index_t idx) { return part.bits_of(sorted[idx].kmer); }));
+		}
+	}
+
+	size_t size_in_bytes() const
+	{
+		size_t size = 0;
+		for (auto &part : parts)
+			size += part.order.size() * sizeof(index_t) + part.lookup_table->bucket_starts.size() * sizeof(size_t);
+
+		return size;
+	}
+
+	// average candidates verified per query, for random kmers
+	double expected_candidates() const
+	{
+		double candidates = 0;
+		for (auto &part : parts)
+			candidates += 2 * std::ldexp(double(sorted.size()), -2 * part.len);
+
+		return candidates;
+	}
+
+	// index in sorted of the closest kmer within max_mismatches from kmer or its reverse complement,
+	// smallest index on ties, NONE if there is no such kmer
+	size_t find(hash_t kmer, int *mismatches = nullptr) const
+	{
+		const hash_t variants[2] = { kmer, seq_transform<hash_t>::to_rev_complement(kmer, kmer_len) };
+
+		// all ranges first, so that the probes can be prefetched together
+		std::pair<size_t, size_t> ranges[2 * MAX_PARTS];
+		int range_count = 0;
+		for (auto variant : variants)
+			for (auto &part : parts)
+			{
+				auto range = part.lookup_table->range(part.bits_of(variant));
+				if (range.first != range.second)
+					__builtin_prefetch(&part.order[range.first]);
+
+				ranges[range_count++] = range;
+			}
+
+		size_t best = NONE;
+		int best_distance = max_mismatches + 1;
+		int r = 0;
+		for (auto variant : variants)
+			for (auto &part : parts)
+			{
+				auto range = ranges[r++];
+				for (auto i = range.first; i < range.second; i++)
+				{
+					auto idx = part.order[i];
+					auto d = distance(sorted[idx].kmer, variant);
+					if (d < best_distance || (d == best_distance && idx < best && d <= max_mismatches))
+					{
+						best_distance = d;
+						best = idx;
+					}
+				}
+			}
+
+		if (mismatches)
+			*mismatches = best_distance;
+
+		return best;
+	}
+
+private:
+	static int popcount(uint64_t x) { return __builtin_popcountll(x); }
+	static int popcount(__uint128_t x) { return popcount(uint64_t(x)) + popcount(uint64_t(x >> 64)); }
+
+	// number of different bases
+	static int distance(hash_t a, hash_t b)
+	{
+		const hash_t low_bits = hash_t(0x5555555555555555ull) | (hash_t(0x5555555555555555ull) << 32 << 32);
+		auto x = a ^ b;
+		return popcount((x | (x >> 1)) & low_bits);
+	}
+};
+
+#endif
@@ -30,13 +30,61 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <type_traits>
+#include <random>
+#include <numeric>
 
 #include "log.h"
 
+// seekable reader interface:
+//   size_t range_units() const; // source size in any units, e.g. rows or bytes
+//   void set_range(size_t first, size_t count); // read() then returns only records from [first, first + count)
+//   static SourceStats merge_range_stats(const std::vector<SourceStats>& stats); // stats of readers of all ranges
+template <typename ReaderType>
+class is_seekable_reader {
+    template <typename T> static auto test(T* t) -> decltype(t->set_range(0, 0), std::true_type());
+    template <typename T> static std::false_type test(...);
+public:
+    static const bool value = decltype(test<ReaderType>(nullptr))::value;
+};
+
+// order of ranges of seekable readers, default is sequential
+// random order makes any prefix of the output a random sample of the source (in units of ranges)
+struct RangeOrder {
+    static const size_t RANDOM_RANGES = 65536; // random order uses smaller ranges, for better sampling
+    bool random;
+    float fraction; // (0, 1], only this fraction of ranges is read, chosen at random
+    size_t min_ranges; // random order splits the source into at least this many ranges
+    unsigned seed;
+
+    RangeOrder() : random(false), fraction(1), min_ranges(RANDOM_RANGES), seed(1) {}
+    RangeOrder(bool random, float fraction, size_t min_ranges = 0)
+        : random(random || fraction < 1), fraction(fraction), min_ranges(min_ranges ? min_ranges : size_t(RANDOM_RANGES)), seed(1) {}
+    bool is_sequential() const { return !random; }
+};
+
+// seekable readers are split into disjoint ranges, each range is decoded by one thread
+// other readers are read by every thread, skipping chunks of other threads
 template <typename ReaderType>
 class MTReader final: public Reader {
 private:
-    typedef std::vector<Fragment> Chunk;
+    typedef std::integral_constant<bool, is_seekable_reader<ReaderType>::value> Seekable;
+
+    struct Ranges {
+        static const size_t PER_THREAD = 16; // for load balancing
+        size_t units;
+        size_t size;
+        size_t count;
+        std::vector<size_t> order; // range indexes to read, empty means all in sequence
+        // protected with global reader lock
+        size_t next;
+        size_t finished;
+        size_t sampled; // non empty ranges all fragments of which have been handed to the consumer
+
+        Ranges() : units(0), size(1), count(0), next(0), finished(0), sampled(0) {}
+
+        size_t first_unit(size_t idx) const { return (order.empty() ? idx : order[idx]) * size; }
+    };
     struct Thread {
         // protected with global reader locked
         bool done;
@@ -44,10 +92,12 @@ private:
         size_t next_chunk_idx;
         bool chunk_ready;
         Chunk loaded_chunk;
+        size_t loaded_ranges; // non empty ranges finished with loaded_chunk
         std::condition_variable consumed;
 
         // private to thread
         size_t chunk_idx;
+        size_t ranges_read;
         ReaderType reader;
         std::thread thread_impl;
 
@@ -56,21 +106,86 @@ private:
             : done(false)
             , progress(0)
             , chunk_ready(false)
+            , loaded_ranges(0)
             , chunk_idx(0)
+            , ranges_read(0)
             , reader(args...)
         {}
         Thread(Thread&& other) = delete;
         Thread(const Thread& other) = delete;
 
-        void run(size_t chunk_size, size_t start_chunk_idx, std::mutex& mutex, std::condition_variable& ready) {
+        void run(size_t chunk_size, size_t start_chunk_idx, std::mutex& mutex, std::condition_variable& ready, Ranges& ranges) {
             try {
-                run_impl(chunk_size, start_chunk_idx, mutex, ready);
+                if (Seekable::value) {
+                    run_ranges_impl(chunk_size, ranges, mutex, ready, Seekable());
+                } else {
+                    run_impl(chunk_size, start_chunk_idx, mutex, ready);
+                }
             } catch (ngs::ErrorMsg error) {
                 LOG("Exception in reader thread: " << error.what());
                 std::terminate();
             }
         }
 
+        void run_ranges_impl(size_t, Ranges&, std::mutex&, std::condition_variable&, std::false_type) {}
+
+        void run_ranges_impl(size_t chunk_size, Ranges& ranges, std::mutex& mutex, std::condition_variable& ready, std::true_type) {
+            Chunk chunk;
+            bool in_range = false;
+            size_t range_fragments = 0;
+            size_t finished_ranges = 0; // not handed over yet, a range can end with an empty chunk
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!done) {
+                if (!in_range) {
+                    if (ranges.next >= ranges.count) {
+                        ranges.sampled += finished_ranges;
+                        done = true;
+                        ready.notify_one();
+                        break;
+                    }
+                    const size_t first = ranges.first_unit(ranges.next);
+                    ++ranges.next;
+                    lock.unlock();
+                    reader.set_range(first, std::min(ranges.size, ranges.units - first));
+                    ++ranges_read;
+                    lock.lock();
+                    in_range = true;
+                    continue;
+                }
+                lock.unlock();
+                { // not locked section
+                    chunk.clear();
+                    while (chunk.size() < chunk_size) {
+                        if (!reader.read(&chunk.add())) {
+                            chunk.pop_back();
+                            break;
+                        }
+                    }
+                }
+                lock.lock();
+                range_fragments += chunk.size();
+                if (chunk.size() < chunk_size) {
+                    in_range = false;
+                    ++ranges.finished;
+                    progress = float(ranges.finished) / ranges.count;
+                    if (range_fragments > 0) {
+                        ++finished_ranges;
+                    }
+                    range_fragments = 0;
+                }
+                if (!chunk.empty()) {
+                    while (chunk_ready) {
+                        consumed.wait(lock);
+                    }
+                    loaded_chunk.swap(chunk);
+                    loaded_ranges = finished_ranges;
+                    finished_ranges = 0;
+                    chunk_ready = true;
+                    ready.notify_one();
+                }
+            }
+        }
+
         void run_impl(size_t chunk_size, size_t start_chunk_idx, std::mutex& mutex, std::condition_variable& ready) {
             size_t skip_to_idx = start_chunk_idx;
             Chunk chunk;
@@ -87,10 +202,10 @@ private:
                         }
                     }
 
-                    chunk.resize(chunk_size);
-                    for (size_t i = 0; i < chunk_size; ++i) {
-                        if (!reader.read(&chunk[i])) {
-                            chunk.resize(i);
+                    chunk.clear();
+                    while (chunk.size() < chunk_size) {
+                        if (!reader.read(&chunk.add())) {
+                            chunk.pop_back();
                             break;
                         }
                     }
@@ -104,7 +219,7 @@ private:
                     while (chunk_ready) {
                         consumed.wait(lock);
                     }
-                    std::swap(loaded_chunk, chunk);
+                    loaded_chunk.swap(chunk);
                     chunk_ready = true;
                     skip_to_idx = next_chunk_idx;
                 }
@@ -117,22 +232,67 @@ private:
     const size_t chunk_size;
     bool all_done;
     size_t next_chunk_idx;
+    Ranges ranges;
     std::vector<std::unique_ptr<Thread> > threads;
     mutable std::mutex mutex;
     std::condition_variable ready;
     
     Chunk current_chunk;
     size_t current_fragment_idx;
+    size_t current_chunk_ranges; // ranges finished with current_chunk, sampled once it is consumed
 
     
+    void init_ranges(size_t, const RangeOrder& order, std::false_type) {
+        if (!order.is_sequential()) {
+            LOG("reader is not seekable, reading all in sequence");
+        }
+    }
+
+    void init_ranges(size_t thread_count, const RangeOrder& order, std::true_type) {
+        ranges.units = threads[0]->reader.range_units();
+        size_t wanted_count = thread_count * Ranges::PER_THREAD;
+        if (!order.is_sequential()) {
+            wanted_count = std::max(wanted_count, order.min_ranges);
+        }
+        ranges.size = std::max((ranges.units + wanted_count - 1) / wanted_count, size_t(1));
+        ranges.count = (ranges.units + ranges.size - 1) / ranges.size;
+        if (!order.is_sequential()) {
+            ranges.order.resize(ranges.count);
+            std::iota(ranges.order.begin(), ranges.order.end(), size_t(0));
+            std::shuffle(ranges.order.begin(), ranges.order.end(), std::mt19937_64(order.seed));
+            const size_t sampled = std::max(size_t(ranges.count * double(order.fraction) + 0.5), size_t(1));
+            if (sampled < ranges.count) {
+                ranges.order.resize(sampled);
+                ranges.count = sampled;
+            }
+        }
+    }
+
+    SourceStats stats(std::false_type) const {
+        return threads[0]->reader.stats();
+    }
+
+    SourceStats stats(std::true_type) const {
+        std::vector<SourceStats> thread_stats;
+        for (auto& thread: threads) {
+            if (thread->ranges_read > 0) {
+                thread_stats.push_back(thread->reader.stats());
+            }
+        }
+        return thread_stats.empty() ? threads[0]->reader.stats() : ReaderType::merge_range_stats(thread_stats);
+    }
+
     bool load_chunk() {
         while (!all_done) {
             std::unique_lock<std::mutex> lock(mutex);
+            ranges.sampled += current_chunk_ranges;
+            current_chunk_ranges = 0;
             size_t done_count = 0;
             for (auto& thread: threads) {
                 if (thread->chunk_ready) {
                     current_fragment_idx = 0;
-                    std::swap(current_chunk, thread->loaded_chunk);
+                    current_chunk.swap(thread->loaded_chunk);
+                    current_chunk_ranges = thread->loaded_ranges;
                     thread->next_chunk_idx = next_chunk_idx;
                     ++next_chunk_idx;
                     thread->chunk_ready = false;
@@ -154,9 +314,15 @@ private:
 public:
     template <typename ...Args>
     MTReader(size_t thread_count, size_t chunk_size, Args... args)
+        : MTReader(RangeOrder(), thread_count, chunk_size, args...)
+    {}
+
+    template <typename ...Args>
+    MTReader(const RangeOrder& order, size_t thread_count, size_t chunk_size, Args... args)
         : chunk_size(chunk_size)
         , all_done(false)
         , current_fragment_idx(0)
+        , current_chunk_ranges(0)
     {
         assert(thread_count > 0);
         threads.resize(thread_count);
@@ -165,12 +331,14 @@ public:
         for (auto i = 0; i < thread_count; ++i) {
             threads[i] = std::unique_ptr<Thread>(new Thread(args...));
         }
+
+        init_ranges(thread_count, order, Seekable());
         
         for (size_t i = 0; i < thread_count; ++i) {
             auto& thread = threads[i];
             const size_t start_chunk_idx = i;
             thread->next_chunk_idx = start_chunk_idx + thread_count;
-            thread->thread_impl = std::thread(&MTReader::Thread::run, thread.get(), chunk_size, start_chunk_idx, std::ref(mutex), std::ref(ready));
+            thread->thread_impl = std::thread(&MTReader::Thread::run, thread.get(), chunk_size, start_chunk_idx, std::ref(mutex), std::ref(ready), std::ref(ranges));
         }
         next_chunk_idx = thread_count * 2;
     }
@@ -189,7 +357,7 @@ public:
 
     SourceStats stats() const override {
         assert(all_done);
-        return threads[0]->reader.stats();
+        return stats(Seekable());
     }
     float progress() const override {
         std::unique_lock<std::mutex> lock(mutex);
@@ -200,6 +368,13 @@ public:
         return max_progress;
     }
 
+    bool random_order() const override { return !ranges.order.empty(); }
+
+    size_t sampled_ranges() const override {
+        std::unique_lock<std::mutex> lock(mutex);
+        return ranges.sampled;
+    }
+
     bool read(Fragment* output) override {
         if (current_fragment_idx >= current_chunk.size()) {
             if (!load_chunk()) {
@@ -214,7 +389,7 @@ public:
         return true;
     }
 
-    bool read_many(std::vector<Fragment>& output) override {
+    bool read_many(Chunk& output) override {
         if (current_fragment_idx >= current_chunk.size()) {
             if (!load_chunk()) {
                 output.clear();
@@ -222,16 +397,16 @@ public:
             }
         }
         if (current_fragment_idx == 0) {
-            std::swap(current_chunk, output);
-            current_fragment_idx = current_chunk.size();
+            current_chunk.swap(output); // consumer's chunk goes back to reader threads
+            current_chunk.clear();
         } else {
-            size_t count = current_chunk.size() - current_fragment_idx;
-            output.resize(count);
-            for (size_t i = 0; i < count; ++i) {
-                std::swap(output[i], current_chunk[i + current_fragment_idx]);
+            output.clear();
+            for (size_t i = current_fragment_idx; i < current_chunk.size(); ++i) {
+                std::swap(output.add(), current_chunk[i]);
             }
-            current_fragment_idx += count;
+            current_chunk.clear();
         }
+        current_fragment_idx = 0;
         assert(!output.empty());
         return true;
     }
@@ -0,0 +1,438 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <zlib.h>
+
+#include "reader.h"
+#include "fasta_reader.h"
+
+// fasta and fastq reader for plain and gzipped (including bgzf) files
+// file is read in big blocks cut at record boundaries, blocks are parsed by worker threads
+// fragments are returned in file order
+// fastq records are expected to be 4 lines each
+class ParallelFastaReader final: public Reader {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+private:
+    enum Format { FASTA, FASTQ };
+
+    // source, protected with source_mutex
+    gzFile file;
+    bool file_eof;
+    std::string carry; // beginning of the first record of the next block
+    size_t next_block_idx;
+    std::mutex source_mutex;
+
+    size_t fsize;
+    Format format;
+    const bool read_qualities;
+    const size_t block_size;
+    const size_t max_parsed_blocks;
+    std::atomic<size_t> read_offset;
+
+    // protected with mutex
+    mutable std::mutex mutex;
+    std::condition_variable parsed_ready;
+    std::condition_variable parsed_consumed;
+    std::map<size_t, Chunk> parsed;
+    std::vector<Chunk> free_chunks; // consumed chunks returned to workers for reuse
+    size_t block_count; // known when source is exhausted
+    size_t next_chunk_idx;
+    size_t spot_count;
+    std::exception_ptr error;
+    bool stopping;
+
+    std::vector<std::thread> workers;
+
+    // consumer side
+    Chunk current_chunk;
+    size_t current_fragment_idx;
+    bool eof;
+
+    static bool ends_with(const std::string &s, const std::string &end) {
+        return end.size() <= s.size() && std::equal(end.rbegin(), end.rend(), s.rbegin());
+    }
+
+    // line [pos, *eol) without line end, returns position of the next line
+    static size_t next_line(const std::string& block, size_t pos, size_t* len) {
+        size_t eol = block.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = block.size();
+        }
+        *len = eol - pos;
+        if (*len > 0 && block[pos + *len - 1] == '\r') {
+            --*len;
+        }
+        return eol + 1;
+    }
+
+    static bool is_fastq_record_start(const std::string& block, size_t pos) {
+        // @header, bases, +
+        size_t len = 0;
+        pos = next_line(block, pos, &len);
+        pos = next_line(block, pos, &len);
+        return pos < block.size() && block[pos] == '+';
+    }
+
+    // start of the last record in block, 0 if not found
+    size_t last_record_start(const std::string& block) const {
+        if (format == FASTA) {
+            auto pos = block.rfind("\n>");
+            return pos == std::string::npos ? 0 : pos + 1;
+        }
+
+        size_t end = block.size();
+        while (end > 0) {
+            auto nl = block.rfind('\n', end - 1);
+            if (nl == std::string::npos) {
+                break;
+            }
+            if (nl + 1 < block.size() && block[nl + 1] == '@' && is_fastq_record_start(block, nl + 1)) {
+                return nl + 1;
+            }
+            end = nl;
+        }
+        return 0;
+    }
+
+    // appends up to size bytes, returns false at eof
+    bool read_file(std::string& block, size_t size) {
+        if (file_eof) {
+            return false;
+        }
+        const size_t old_size = block.size();
+        block.resize(old_size + size);
+        int got = gzread(file, &block[old_size], unsigned(size));
+        if (got < 0) {
+            int errnum = 0;
+            throw std::runtime_error(std::string("cannot read file: ") + gzerror(file, &errnum));
+        }
+        block.resize(old_size + got);
+        file_eof = size_t(got) < size;
+        read_offset = gzoffset(file);
+        return got > 0;
+    }
+
+    // protected with source_mutex
+    bool cut_next_block(std::string& block) {
+        block.clear();
+        block.swap(carry);
+        while (true) {
+            read_file(block, block_size);
+            if (file_eof) {
+                return !block.empty();
+            }
+            auto cut = last_record_start(block);
+            if (cut > 0) { // otherwise record is bigger than block, reading more
+                carry.assign(block, cut, std::string::npos);
+                block.resize(cut);
+                return true;
+            }
+        }
+    }
+
+    void parse_fasta(const std::string& block, Chunk& chunk) const {
+        Fragment* current = nullptr;
+        size_t pos = 0;
+        size_t len = 0;
+        while (pos < block.size()) {
+            const size_t line = pos;
+            pos = next_line(block, pos, &len);
+            if (len == 0) {
+                continue;
+            }
+            if (block[line] == '>') {
+                current = &chunk.add();
+                current->spotid.assign(block, line + 1, len - 1);
+                current->bases.clear();
+            } else {
+                if (!current) {
+                    throw std::runtime_error("this is not a fasta file");
+                }
+                current->bases.append(block, line, len);
+            }
+        }
+
+        for (auto& fragment: chunk) {
+            if (fragment.bases.empty()) {
+                throw std::runtime_error("Read is empty");
+            }
+        }
+    }
+
+    void parse_fastq(const std::string& block, Chunk& chunk) const {
+        size_t pos = 0;
+        size_t len = 0;
+        while (pos < block.size()) {
+            const size_t header = pos;
+            pos = next_line(block, pos, &len);
+            if (len == 0) {
+                continue;
+            }
+            if (block[header] != '@') {
+                throw std::runtime_error("this is not a fastq file");
+            }
+            auto& fragment = chunk.add();
+            fragment.spotid.assign(block, header + 1, len - 1);
+
+            const size_t bases = pos;
+            size_t bases_len = 0;
+            pos = next_line(block, pos, &bases_len);
+            fragment.bases.assign(block, bases, bases_len);
+
+            const size_t plus = pos;
+            pos = next_line(block, pos, &len);
+            if (plus >= block.size() || block[plus] != '+') {
+                throw std::runtime_error("invalid fastq record: " + fragment.spotid);
+            }
+
+            const size_t qualities = pos;
+            pos = next_line(block, pos, &len);
+            if (qualities >= block.size() || len != bases_len) {
+                throw std::runtime_error("invalid fastq qualities: " + fragment.spotid);
+            }
+            if (fragment.bases.empty()) {
+                throw std::runtime_error("Read is empty");
+            }
+            if (read_qualities) {
+                for (size_t i = 0; i < bases_len; ++i) {
+                    static const int SAM_QUALITY_BASE = 33;
+                    static const int MIN_GOOD_QUALITY = SAM_QUALITY_BASE + 3;
+                    if ((unsigned char)block[qualities + i] < MIN_GOOD_QUALITY) {
+                        fragment.bases[i] = '!'; // same as vdb reader
+                    }
+                }
+            }
+        }
+    }
+
+    void run() {
+        std::string block;
+        Chunk chunk;
+        while (true) {
+            size_t block_idx = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping && !error && parsed.size() >= max_parsed_blocks) {
+                    parsed_consumed.wait(lock);
+                }
+                if (stopping || error) {
+                    return;
+                }
+                if (!free_chunks.empty()) {
+                    chunk.swap(free_chunks.back());
+                    free_chunks.pop_back();
+                }
+            }
+
+            chunk.clear();
+            try {
+                {
+                    std::lock_guard<std::mutex> source_lock(source_mutex);
+                    if (!cut_next_block(block)) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        block_count = next_block_idx;
+                        parsed_ready.notify_all();
+                        return;
+                    }
+                    block_idx = next_block_idx++;
+                }
+
+                if (format == FASTA) {
+                    parse_fasta(block, chunk);
+                } else {
+                    parse_fastq(block, chunk);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+                parsed_ready.notify_all();
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            spot_count += chunk.size();
+            parsed[block_idx].swap(chunk);
+            parsed_ready.notify_all();
+        }
+    }
+
+    bool load_chunk() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            auto it = parsed.find(next_chunk_idx);
+            if (it != parsed.end()) {
+                free_chunks.emplace_back();
+                free_chunks.back().swap(current_chunk);
+                current_chunk.swap(it->second);
+                current_fragment_idx = 0;
+                parsed.erase(it);
+                ++next_chunk_idx;
+                parsed_consumed.notify_one();
+                if (current_chunk.empty()) {
+                    continue;
+                }
+                return true;
+            }
+            if (next_chunk_idx >= block_count) {
+                eof = true;
+                return false;
+            }
+            parsed_ready.wait(lock);
+        }
+    }
+
+public:
+    static bool is_supported(const std::string& filename) {
+        auto name = ends_with(filename, ".gz") ? filename.substr(0, filename.size() - 3) : filename;
+        return FastaReader::is_fasta(name) || ends_with(name, ".fastq") || ends_with(name, ".fq");
+    }
+
+    ParallelFastaReader(const std::string& filename, int thread_count, bool read_qualities = false, size_t block_size = DEFAULT_BLOCK_SIZE)
+        : file(gzopen(filename.c_str(), "rb"))
+        , file_eof(false)
+        , next_block_idx(0)
+        , fsize(0)
+        , read_qualities(read_qualities)
+        , block_size(block_size)
+        , max_parsed_blocks(std::max(thread_count, 1) * 2)
+        , read_offset(0)
+        , block_count(size_t(-1))
+        , next_chunk_idx(0)
+        , spot_count(0)
+        , stopping(false)
+        , current_fragment_idx(0)
+        , eof(false)
+    {
+        if (!file) {
+            throw std::runtime_error("cannot open file " + filename);
+        }
+        {
+            std::ifstream f(filename, std::ios::binary | std::ios::ate);
+            fsize = f.tellg();
+        }
+        gzbuffer(file, 1024 * 1024);
+
+        while (carry.empty() && read_file(carry, 1)) {
+            if (isspace(carry[0])) {
+                carry.clear();
+            }
+        }
+        if (carry.empty()) {
+            gzclose(file);
+            throw std::runtime_error("fasta file is empty");
+        }
+        if (carry[0] == '>') {
+            format = FASTA;
+        } else if (carry[0] == '@') {
+            format = FASTQ;
+        } else {
+            gzclose(file);
+            throw std::runtime_error("this is not a fasta file");
+        }
+
+        for (int i = 0; i < std::max(thread_count, 1); ++i) {
+            workers.push_back(std::thread(&ParallelFastaReader::run, this));
+        }
+    }
+
+    ~ParallelFastaReader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            parsed_consumed.notify_all();
+        }
+        for (auto& worker: workers) {
+            worker.join();
+        }
+        gzclose(file);
+    }
+
+    SourceStats stats() const override {
+        assert(eof);
+        std::lock_guard<std::mutex> lock(mutex);
+        return SourceStats(spot_count);
+    }
+
+    float progress() const override {
+        if (eof || !fsize) {
+            return 1;
+        }
+        return std::min(1.0f, float(read_offset) / fsize);
+    }
+
+    bool read(Fragment* output) override {
+        if (current_fragment_idx >= current_chunk.size()) {
+            if (eof || !load_chunk()) {
+                return false;
+            }
+        }
+        if (output) {
+            std::swap(*output, current_chunk[current_fragment_idx]);
+        }
+        ++current_fragment_idx;
+        return true;
+    }
+
+    bool read_many(Chunk& output) override {
+        if (current_fragment_idx >= current_chunk.size()) {
+            if (eof || !load_chunk()) {
+                output.clear();
+                return false;
+            }
+        }
+        if (current_fragment_idx == 0) {
+            current_chunk.swap(output); // consumer's chunk is recycled by load_chunk
+            current_chunk.clear();
+        } else {
+            output.clear();
+            for (size_t i = current_fragment_idx; i < current_chunk.size(); ++i) {
+                std::swap(output.add(), current_chunk[i]);
+            }
+            current_chunk.clear();
+        }
+        current_fragment_idx = 0;
+        assert(!output.empty());
+        return true;
+    }
+};
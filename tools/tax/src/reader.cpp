@@ -26,6 +26,7 @@
 
 #include "reader.h"
 #include "fasta_reader.h"
+#include "parallel_fasta_reader.h"
 #include "vdb_reader.h"
 #include "mt_reader.h"
 #include "aux_reader.h"
@@ -40,41 +41,72 @@ static ReaderPtr create_wrapped(bool split_non_atgc, ReaderArgs... args) {
 }
 
 template <typename ReaderImpl, typename... ReaderArgs>
-static ReaderPtr create_filtered(const std::string& filter_file, bool exclude_filter, bool split_non_atgc, ReaderArgs... args) {
-    if (!filter_file.empty()) {
+static ReaderPtr create_filtered(const SpotSetPtr& filter, bool exclude_filter, bool split_non_atgc, ReaderArgs... args) {
+    if (filter) {
         if (exclude_filter) {
-            return create_wrapped<FilteringReader<ReaderImpl, ExcludeFileSpotFilter>>(split_non_atgc, filter_file, args...);
+            return create_wrapped<FilteringReader<ReaderImpl, ExcludeFileSpotFilter>>(split_non_atgc, filter, args...);
         } else {
-            return create_wrapped<FilteringReader<ReaderImpl, IncludeFileSpotFilter>>(split_non_atgc, filter_file, args...);
+            return create_wrapped<FilteringReader<ReaderImpl, IncludeFileSpotFilter>>(split_non_atgc, filter, args...);
         }
     } else {
         return create_wrapped<ReaderImpl>(split_non_atgc, args...);
     }
 }
 
-template <typename ReaderImpl, typename... ReaderArgs>
-static ReaderPtr create_threaded(const std::string& filter_file, bool exclude_filter, bool split_non_atgc, int thread_count, size_t chunk_size, ReaderArgs... args) {
+static int auto_thread_count(int thread_count) {
     if (thread_count < 0) {
         thread_count = std::max(std::thread::hardware_concurrency() / 2, 1u);
     }
+    return thread_count;
+}
+
+// ReaderImpl must be seekable for non sequential order
+template <typename ReaderImpl, typename... ReaderArgs>
+static ReaderPtr create_threaded(const SpotSetPtr& filter, bool exclude_filter, bool split_non_atgc, int thread_count, size_t chunk_size, const RangeOrder& order, ReaderArgs... args) {
+    thread_count = auto_thread_count(thread_count);
     if (chunk_size == 0) {
         chunk_size = Reader::DEFAULT_CHUNK_SIZE;
     }
-    if (thread_count > 1) {
-        return create_filtered<MTReader<ReaderImpl>>(filter_file, exclude_filter, split_non_atgc, thread_count, chunk_size, args...);
+    if (!order.is_sequential()) {
+        return create_filtered<MTReader<ReaderImpl>>(filter, exclude_filter, split_non_atgc, order, std::max(thread_count, 1), chunk_size, args...);
+    } else if (thread_count > 1) {
+        return create_filtered<MTReader<ReaderImpl>>(filter, exclude_filter, split_non_atgc, thread_count, chunk_size, args...);
     } else {
-        return create_filtered<ReaderImpl>(filter_file, exclude_filter, split_non_atgc, args...);
+        return create_filtered<ReaderImpl>(filter, exclude_filter, split_non_atgc, args...);
     }
 }
 
 ReaderPtr Reader::create(const std::string& path, const Reader::Params& params) {
-    if (FastaReader::is_fasta(path)) {
-        return create_threaded<FastaReader>(params.filter_file, params.exclude_filter, params.split_non_atgc, params.thread_count, params.chunk_size, path);
+    SpotSetPtr filter;
+    if (!params.filter_file.empty()) {
+        filter = std::make_shared<SpotSet>(params.filter_file);
+    }
+
+    const RangeOrder order(params.random_order, params.sample_fraction, params.random_ranges);
+    if (ParallelFastaReader::is_supported(path)) {
+        const int thread_count = auto_thread_count(params.thread_count);
+        if (!order.is_sequential()) {
+            if (FastaReader::is_fasta(path)) {
+                return create_threaded<FastaReader>(filter, params.exclude_filter, params.split_non_atgc, thread_count, params.chunk_size, order, path);
+            }
+            LOG("random order is not supported for " << path << ", reading all in sequence");
+        }
+        if (FastaReader::is_fasta(path) && thread_count <= 1) {
+            return create_filtered<FastaReader>(filter, params.exclude_filter, params.split_non_atgc, path);
+        }
+        return create_filtered<ParallelFastaReader>(filter, params.exclude_filter, params.split_non_atgc, path, thread_count, params.read_qualities);
     } else {
         if (!params.unaligned_only && AlignedVdbReader::is_aligned(path)) {
-            return create_threaded<AlignedVdbReader>(params.filter_file, params.exclude_filter, params.split_non_atgc, params.thread_count, params.chunk_size, path, params.read_qualities);
+            return create_threaded<AlignedVdbReader>(filter, params.exclude_filter, params.split_non_atgc, params.thread_count, params.chunk_size, order, path, params.read_qualities);
+        } else if (filter && !params.exclude_filter && filter->is_numeric()) {
+            // vdb spot ids are row ids, so only selected rows are read
+            return create_threaded<SelectedRowsReader<VdbReader>>(SpotSetPtr(), false, params.split_non_atgc, params.thread_count, params.chunk_size, order, filter, path, params.read_qualities, params.unaligned_only);
+        } else if (params.vdb_blobs && !params.read_qualities && !params.unaligned_only && order.is_sequential()) {
+            // one background thread is enough to decode blobs
+            const size_t chunk_size = params.chunk_size ? params.chunk_size : Reader::DEFAULT_CHUNK_SIZE;
+            return create_filtered<MTReader<VdbBlobReader>>(filter, params.exclude_filter, params.split_non_atgc, 1, chunk_size, path);
         } else {
-            return create_threaded<VdbReader>(params.filter_file, params.exclude_filter, params.split_non_atgc, params.thread_count, params.chunk_size, path, params.read_qualities, params.unaligned_only);
+            return create_threaded<VdbReader>(filter, params.exclude_filter, params.split_non_atgc, params.thread_count, params.chunk_size, order, path, params.read_qualities, params.unaligned_only);
         }
     }
 }
@@ -47,6 +47,41 @@ public:
         bool operator == (const Fragment& other) const { return spotid == other.spotid && bases == other.bases; }
     };
 
+    // fragments reused between reads: clear() keeps fragments with their buffers,
+    // so refilling a warmed up chunk does not allocate
+    class Chunk {
+    private:
+        std::vector<Fragment> fragments;
+        size_t count;
+    public:
+        Chunk() : count(0) {}
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        void clear() { count = 0; }
+
+        // returns next fragment to fill, its old content is garbage
+        Fragment& add() {
+            if (count == fragments.size()) {
+                fragments.emplace_back();
+            }
+            return fragments[count++];
+        }
+        void pop_back() { assert(count > 0); --count; }
+
+        Fragment& operator[] (size_t i) { assert(i < count); return fragments[i]; }
+        const Fragment& operator[] (size_t i) const { assert(i < count); return fragments[i]; }
+        Fragment* begin() { return fragments.data(); }
+        Fragment* end() { return fragments.data() + count; }
+        const Fragment* begin() const { return fragments.data(); }
+        const Fragment* end() const { return fragments.data() + count; }
+
+        void swap(Chunk& other) {
+            fragments.swap(other.fragments);
+            std::swap(count, other.count);
+        }
+    };
+
     struct SourceStats {
         size_t spot_count;
         size_t expected_spot_count; // hint, tries to account for filtering
@@ -83,14 +118,21 @@ public:
     // returns false when at eof
     virtual bool read(Fragment* output) = 0;
 
+    // true if the source is read in random order of ranges (see RangeOrder), so any prefix of the output is a random sample
+    virtual bool random_order() const { return false; }
+
+    // random order only: number of ranges all fragments of which have been read so far
+    // ranges are the sampling units, reads of one range are not independent
+    virtual size_t sampled_ranges() const { return 0; }
+
     // read the most efficient count of fragments into output
     // replaces output content
     // returns true if anything was read (i.e. output is not empty)
-    virtual bool read_many(std::vector<Fragment>& output) {
-        output.resize(std::max(output.capacity(), size_t(DEFAULT_CHUNK_SIZE)));
-        for (size_t i = 0; i < output.size(); ++i) {
-            if (!read(&output[i])) {
-                output.resize(i);
+    virtual bool read_many(Chunk& output) {
+        output.clear();
+        while (output.size() < DEFAULT_CHUNK_SIZE) {
+            if (!read(&output.add())) {
+                output.pop_back();
                 break;
             }
         }
@@ -104,9 +146,13 @@ public:
         bool read_qualities; // if true, low quality bases replaced with N
         bool split_non_atgc; // if true, splits reads by non-atgc characters, otherwise cuts reads at first non-atgc character
         bool unaligned_only; // if true, skips aligned reads
+        bool vdb_blobs; // opt-in: unaligned runs are read from blobs (see VdbBlobReader) when qualities, unaligned_only and random order are not needed
+        bool random_order; // if true, seekable sources (vdb runs, uncompressed fasta) are read in random order of row ranges
+        float sample_fraction; // (0, 1], seekable sources are read only partially, random row ranges of this fraction, implies random_order
+        size_t random_ranges; // random order splits sources into at least this many ranges, 0 means RangeOrder::RANDOM_RANGES
         int thread_count; // default means auto
         size_t chunk_size; ; // default means auto
-        Params() : exclude_filter(false), read_qualities(false), split_non_atgc(false), unaligned_only(false), thread_count(-1), chunk_size(0) {}
+        Params() : exclude_filter(false), read_qualities(false), split_non_atgc(false), unaligned_only(false), vdb_blobs(false), random_order(false), sample_fraction(1), random_ranges(0), thread_count(-1), chunk_size(0) {}
     };
     // factory method, creates corresponding reader depending on file type
     static ReaderPtr create(const std::string& path, const Params& params = Params());
@@ -0,0 +1,111 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef SCREENING_H_INCLUDED
+#define SCREENING_H_INCLUDED
+
+#include <cmath>
+#include <stddef.h>
+#include <algorithm>
+
+// presence/absence decision on the fraction of matched spots
+// spots must come in random order of ranges (see Reader::random_order), so that every prefix is a sample
+// the sample is clustered: spots of a range are neighbours in the source and are not independent,
+// so the interval counts every completed range as one observation, the worst case of all spots of a range
+// matching or not together, and aligns_to splits the input into small ranges (RANGES) to have many of them
+// decided as soon as wilson score interval of the matched fraction is entirely above or below threshold
+// interval is checked after every chunk, so z is much stricter than for a single test
+struct ScreeningTest
+{
+	enum Decision { UNDECIDED, PRESENT, ABSENT };
+
+	static constexpr double Z = 4.0; // ~ 6e-5 two sided per look
+	static const size_t MIN_RANGES = 1000; // normal approximation and randomness of first ranges
+	static const size_t RANGES = 1 << 20; // ranges to split the input into, ~100 spots per range for a 100M spots run
+
+	const double threshold;
+	size_t reads, matched; // spots
+	size_t ranges; // completed ranges
+	Decision decision;
+
+	ScreeningTest(double threshold) : threshold(threshold), reads(0), matched(0), ranges(0), decision(UNDECIDED) {}
+
+	// ranges_done is the total number of completed ranges so far, see Reader::sampled_ranges
+	Decision add(size_t chunk_reads, size_t chunk_matched, size_t ranges_done)
+	{
+		reads += chunk_reads;
+		matched += chunk_matched;
+		ranges = std::max(ranges, ranges_done);
+		if (decision == UNDECIDED && ranges >= MIN_RANGES)
+		{
+			double low, high;
+			interval(&low, &high);
+			if (low > threshold)
+				decision = PRESENT;
+			else if (high < threshold)
+				decision = ABSENT;
+		}
+
+		return decision;
+	}
+
+	double fraction() const
+	{
+		return reads ? double(matched) / reads : 0;
+	}
+
+	// effective sample size is the number of completed ranges
+	void interval(double *low, double *high) const
+	{
+		const size_t observations = std::min(ranges, reads);
+		if (!observations)
+		{
+			*low = 0;
+			*high = 1;
+			return;
+		}
+
+		const double n = double(observations);
+		const double p = fraction();
+		const double z2 = Z * Z;
+		const double center = (p + z2 / (2 * n)) / (1 + z2 / n);
+		const double half_width = Z * std::sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+		*low = std::max(0.0, center - half_width);
+		*high = std::min(1.0, center + half_width);
+	}
+
+	static const char *to_string(Decision decision)
+	{
+		switch (decision)
+		{
+			case PRESENT: return "present";
+			case ABSENT: return "absent";
+			default: return "undecided";
+		}
+	}
+};
+
+#endif
@@ -36,16 +36,14 @@
 
 using namespace std;
 
-const string VERSION = "0.12";
+const string VERSION = "0.13";
 
 typedef uint64_t hash_t;
 
 #include "dbs.h"
 
-typedef DBS::Kmers Kmers;
-typedef vector<hash_t> Hashes;
-
-bool split_by_tax_less(const DBS::KmerTax &a, const DBS::KmerTax &b)
+template <class K>
+bool split_by_tax_less(const DBS::KmerTaxOf<K> &a, const DBS::KmerTaxOf<K> &b)
 {
 	if (a.tax_id == b.tax_id)
 		return a.kmer < b.kmer;
@@ -53,7 +51,8 @@ bool split_by_tax_less(const DBS::KmerTax &a, const DBS::KmerTax &b)
 	return a.tax_id < b.tax_id;
 }
 
-void to_hashes(const Kmers &kmers, Hashes &hashes)
+template <class K>
+void to_hashes(const vector<DBS::KmerTaxOf<K>> &kmers, vector<K> &hashes)
 {
 	hashes.clear();
 	hashes.resize(kmers.size());
@@ -78,7 +77,8 @@ void save_annotation(const string &filename, const Annotation &annotation)
 		f << a.tax_id << '\t' << a.count << endl;
 }
 
-Annotation get_annotation(const Kmers &kmers)
+template <class K>
+Annotation get_annotation(const vector<DBS::KmerTaxOf<K>> &kmers)
 {
 	Annotation a;
 	if (kmers.empty())
@@ -100,18 +100,29 @@ Annotation get_annotation(const Kmers &kmers)
 	return a;
 }
 
+// format (128 bit keys, spaced seed) is kept as is
+template <class K>
+void sort_dbs(const Config &config)
+{
+	vector<DBS::KmerTaxOf<K>> kmers;
+	DBSIO::Format format;
+	DBSIO::load_dbs(config.input_filename, kmers, &format);
+	std::sort(kmers.begin(), kmers.end(), split_by_tax_less<K>);
+	vector<K> hashes;
+	to_hashes(kmers, hashes);
+	DBSIO::save_dbs(config.out_filename, hashes, format);
+	save_annotation(config.out_filename + ".annotation", get_annotation(kmers));
+}
+
 int main(int argc, char const *argv[])
 {
 	Config config(argc, argv);
 	LOG("sort_dbs version " << VERSION);
 
-	Kmers kmers;
-	auto kmer_len = DBSIO::load_dbs(config.input_filename, kmers);
-	std::sort(kmers.begin(), kmers.end(), split_by_tax_less);
-	Hashes hashes;
-	to_hashes(kmers, hashes);
-	DBSIO::save_dbs(config.out_filename, hashes, kmer_len);
-	save_annotation(config.out_filename + ".annotation", get_annotation(kmers));
+	if (DBSIO::load_format(config.input_filename).key_bytes == sizeof(__uint128_t))
+		sort_dbs<__uint128_t>(config);
+	else
+		sort_dbs<uint64_t>(config);
 
     return 0;
 }
@@ -0,0 +1,125 @@
+#ifndef SPACED_SEED_H_INCLUDED
+#define SPACED_SEED_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "hash.h"
+
+// kmer scanners, for_all_hashes_do calls lambda(key) for every kmer of a sequence until lambda returns false
+// keys use the same 2 bit encoding as Hash, so seq_transform works on them with kmer_len = key_len()
+
+// contiguous kmers, exactly Hash::for_all_hashes_do
+template <class hash_t>
+struct ContiguousKmers
+{
+	int kmer_len;
+
+	ContiguousKmers(int kmer_len) : kmer_len(kmer_len){}
+
+	int span() const { return kmer_len; }
+	int key_len() const { return kmer_len; }
+
+	template <class Lambda>
+	void for_all_hashes_do(const std::string &s, Lambda &&lambda) const
+	{
+		Hash<hash_t>::for_all_hashes_do(s, kmer_len, lambda);
+	}
+};
+
+// spaced seed like "1101101011": key is made of the bases at '1' positions of a window of seed length
+// seed has to be symmetric, then the key of the reverse complement window is the reverse complement of the key,
+// so canonical keys are min_hash_variant of keys, as for contiguous kmers
+// window_t holds 2 bits per base of the window, hash_t 2 bits per '1' of the seed
+template <class hash_t, class window_t = hash_t>
+struct SpacedKmers
+{
+	struct Run // consecutive '1's: window bits [shift, shift + bits) go to key bits [key_shift, key_shift + bits)
+	{
+		int shift, key_shift;
+		window_t mask;
+	};
+
+	std::string seed;
+	int weight;
+	std::vector<Run> runs;
+
+	SpacedKmers(const std::string &seed) : seed(seed), weight(0)
+	{
+		if (!is_valid(seed))
+			throw std::runtime_error("invalid spaced seed " + seed);
+
+		const int span = int(seed.size());
+		if (span > int(sizeof(window_t) * 4))
+			throw std::runtime_error("spaced seed is too long: " + seed);
+
+		weight = int(std::count(seed.begin(), seed.end(), '1'));
+		if (weight > int(sizeof(hash_t) * 4))
+			throw std::runtime_error("spaced seed has too many bases for the key: " + seed);
+
+		int key_bases = 0; // before the run
+		for (int i = 0; i < span; )
+		{
+			if (seed[i] == '0')
+			{
+				i++;
+				continue;
+			}
+
+			int end = i;
+			while (end < span && seed[end] == '1')
+				end++;
+
+			const int len = end - i;
+			Run run;
+			run.shift = 2 * (span - end);
+			run.key_shift = 2 * (weight - key_bases - len);
+			run.mask = (window_t(1) << (2 * len - 1) << 1) - 1;
+			runs.push_back(run);
+			key_bases += len;
+			i = end;
+		}
+	}
+
+	// symmetric, '0' and '1' only, at least one '0', starts and ends with '1'
+	static bool is_valid(const std::string &seed)
+	{
+		if (seed.size() < 3 || seed.front() != '1' || seed.back() != '1' || seed.find('0') == std::string::npos)
+			return false;
+
+		if (seed.find_first_not_of("01") != std::string::npos)
+			return false;
+
+		return std::equal(seed.begin(), seed.end(), seed.rbegin());
+	}
+
+	int span() const { return int(seed.size()); }
+	int key_len() const { return weight; }
+
+	hash_t key_of(window_t window) const
+	{
+		hash_t key = 0;
+		for (auto &run : runs)
+			key |= hash_t((window >> run.shift) & run.mask) << run.key_shift;
+
+		return key;
+	}
+
+	// key of a string of span() bases
+	hash_t key_of(const std::string &s) const
+	{
+		return key_of(Hash<window_t>::hash_of(s));
+	}
+
+	template <class Lambda>
+	void for_all_hashes_do(const std::string &s, Lambda &&lambda) const
+	{
+		Hash<window_t>::for_all_hashes_do(s, span(), [&](window_t window)
+			{
+				return lambda(key_of(window));
+			});
+	}
+};
+
+#endif
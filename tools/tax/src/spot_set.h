@@ -0,0 +1,345 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+// sorted set of uint64 values, elias-fano coded: about 2 + log2(max / size) bits per value
+class EliasFanoSet {
+private:
+    static const size_t ZERO_SAMPLE = 256;
+
+    size_t count;
+    int low_bits;
+    uint64_t max_high;
+    std::vector<uint64_t> lows;  // count * low_bits, packed
+    std::vector<uint64_t> highs; // one bit per value plus terminating zero per high bucket
+    size_t highs_size;
+    std::vector<size_t> zero_samples; // position of every ZERO_SAMPLE-th zero in highs
+
+    bool high_bit(size_t pos) const { return (highs[pos / 64] >> (pos % 64)) & 1; }
+
+    uint64_t low(size_t idx) const {
+        if (!low_bits) {
+            return 0;
+        }
+        const size_t bit = idx * low_bits;
+        const size_t word = bit / 64;
+        const int shift = bit % 64;
+        uint64_t value = lows[word] >> shift;
+        if (shift + low_bits > 64) {
+            value |= lows[word + 1] << (64 - shift);
+        }
+        return value & ((uint64_t(1) << low_bits) - 1);
+    }
+
+    // position of the k-th (0 based) zero in highs
+    size_t select0(size_t k) const {
+        size_t pos = zero_samples[k / ZERO_SAMPLE];
+        size_t remaining = k % ZERO_SAMPLE;
+        if (!remaining) {
+            return pos;
+        }
+        ++pos;
+        while (true) {
+            uint64_t zeros = ~highs[pos / 64] >> (pos % 64);
+            const size_t available = 64 - pos % 64;
+            if (available < 64) {
+                zeros &= (uint64_t(1) << available) - 1;
+            }
+            const size_t found = __builtin_popcountll(zeros);
+            if (found >= remaining) {
+                for (size_t i = 1; i < remaining; ++i) {
+                    zeros &= zeros - 1;
+                }
+                return pos + __builtin_ctzll(zeros);
+            }
+            remaining -= found;
+            pos += available;
+        }
+    }
+
+public:
+    static const uint64_t NONE = uint64_t(-1);
+
+    EliasFanoSet() : count(0), low_bits(0), max_high(0), highs_size(0) {}
+
+    // values must be sorted and unique
+    explicit EliasFanoSet(const std::vector<uint64_t>& values) : count(values.size()), low_bits(0) {
+        const uint64_t max_value = values.empty() ? 0 : values.back();
+        while (count && low_bits < 63 && (max_value >> (low_bits + 1)) >= count) {
+            ++low_bits;
+        }
+        max_high = max_value >> low_bits;
+        highs_size = count + size_t(max_high) + 1;
+        highs.resize(highs_size / 64 + 1);
+        lows.resize(count * low_bits / 64 + 2);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (i && values[i] <= values[i - 1]) {
+                throw std::runtime_error("EliasFanoSet: values are not sorted");
+            }
+            const size_t pos = size_t(values[i] >> low_bits) + i;
+            highs[pos / 64] |= uint64_t(1) << (pos % 64);
+            if (low_bits) {
+                const uint64_t l = values[i] & ((uint64_t(1) << low_bits) - 1);
+                const size_t bit = i * low_bits;
+                lows[bit / 64] |= l << (bit % 64);
+                if (bit % 64 + low_bits > 64) {
+                    lows[bit / 64 + 1] |= l >> (64 - bit % 64);
+                }
+            }
+        }
+
+        size_t zeros = 0;
+        for (size_t word = 0; word < highs.size(); ++word) {
+            uint64_t bits = ~highs[word];
+            const size_t valid = std::min(size_t(64), highs_size - word * 64);
+            if (valid < 64) {
+                bits &= (uint64_t(1) << valid) - 1;
+            }
+            const size_t found = __builtin_popcountll(bits);
+            const size_t sample = zero_samples.size() * ZERO_SAMPLE;
+            if (sample < zeros + found) { // at most one sample per word
+                for (size_t i = 0; i < sample - zeros; ++i) {
+                    bits &= bits - 1;
+                }
+                zero_samples.push_back(word * 64 + __builtin_ctzll(bits));
+            }
+            zeros += found;
+        }
+    }
+
+    size_t size() const { return count; }
+
+    size_t size_in_bytes() const {
+        return (lows.size() + highs.size()) * sizeof(uint64_t) + zero_samples.size() * sizeof(size_t);
+    }
+
+    // smallest value >= x, NONE if there is no such value
+    uint64_t next(uint64_t x) const {
+        if (!count) {
+            return NONE;
+        }
+        const uint64_t high = x >> low_bits;
+        if (high > max_high) {
+            return NONE;
+        }
+        size_t pos = high ? select0(size_t(high) - 1) + 1 : 0;
+        size_t idx = pos - size_t(high);
+        for (; idx < count; ++pos) {
+            if (high_bit(pos)) {
+                const uint64_t value = (uint64_t(pos - idx) << low_bits) | low(idx);
+                if (value >= x) {
+                    return value;
+                }
+                ++idx;
+            }
+        }
+        return NONE;
+    }
+
+    bool contains(uint64_t x) const {
+        return x != NONE && next(x) == x;
+    }
+};
+
+// plain bitmap for dense sets of small numbers
+class BitSet {
+private:
+    std::vector<uint64_t> words;
+    size_t count;
+
+public:
+    static const uint64_t NONE = uint64_t(-1);
+
+    BitSet() : count(0) {}
+
+    explicit BitSet(const std::vector<uint64_t>& values) : count(values.size()) {
+        words.resize(values.empty() ? 0 : size_t(values.back() / 64 + 1));
+        for (auto value: values) {
+            words[value / 64] |= uint64_t(1) << (value % 64);
+        }
+    }
+
+    size_t size() const { return count; }
+    size_t size_in_bytes() const { return words.size() * sizeof(uint64_t); }
+
+    bool contains(uint64_t x) const {
+        return x / 64 < words.size() && ((words[x / 64] >> (x % 64)) & 1);
+    }
+
+    uint64_t next(uint64_t x) const {
+        size_t word = size_t(x / 64);
+        if (word >= words.size()) {
+            return NONE;
+        }
+        uint64_t bits = words[word] & (uint64_t(-1) << (x % 64));
+        while (!bits) {
+            if (++word >= words.size()) {
+                return NONE;
+            }
+            bits = words[word];
+        }
+        return uint64_t(word) * 64 + __builtin_ctzll(bits);
+    }
+};
+
+// compact set of spot ids, as listed in -spot_filter files
+// ids are stripped at the first dot, empty lines are ignored
+// decimal ids are kept as numbers (bitmap if dense, elias-fano otherwise)
+// if there is any non-decimal id, all ids are kept as 64 bit fingerprints,
+// false positive rate is about size / 2^64
+class SpotSet {
+private:
+    enum Mode { NUMERIC_BITSET, NUMERIC_ELIAS_FANO, FINGERPRINTS };
+
+    Mode mode;
+    BitSet bitset;
+    EliasFanoSet elias_fano;
+
+    static uint64_t mix(uint64_t x) { // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    template <typename Iterator>
+    static uint64_t fingerprint(Iterator begin, Iterator end) {
+        uint64_t h = 0xcbf29ce484222325ULL; // fnv-1a
+        for (auto it = begin; it != end; ++it) {
+            h = (h ^ (unsigned char)*it) * 0x100000001b3ULL;
+        }
+        return mix(h);
+    }
+
+    // canonical decimal only, so that "007" and "7" stay different ids
+    template <typename Iterator>
+    static bool parse_number(Iterator begin, Iterator end, uint64_t* number) {
+        const auto len = end - begin;
+        if (len == 0 || len > 19 || (*begin == '0' && len > 1)) {
+            return false;
+        }
+        uint64_t n = 0;
+        for (auto it = begin; it != end; ++it) {
+            if (*it < '0' || *it > '9') {
+                return false;
+            }
+            n = n * 10 + uint64_t(*it - '0');
+        }
+        *number = n;
+        return true;
+    }
+
+    static void sort_unique(std::vector<uint64_t>& values) {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    }
+
+public:
+    static const uint64_t NONE = uint64_t(-1);
+
+    explicit SpotSet(const std::string& path) {
+        std::ifstream is(path);
+        if (!is) {
+            throw std::runtime_error("cannot open spot filter file " + path);
+        }
+        std::vector<uint64_t> values;
+        bool numeric = true;
+        std::string line;
+        while (std::getline(is, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            auto end = std::find(line.begin(), line.end(), '.'); // strip dot and everything after
+            if (end == line.begin()) {
+                continue;
+            }
+            uint64_t number = 0;
+            if (numeric && parse_number(line.begin(), end, &number)) {
+                values.push_back(number);
+                continue;
+            }
+            if (numeric) {
+                numeric = false;
+                for (auto& value: values) {
+                    auto s = std::to_string(value);
+                    value = fingerprint(s.begin(), s.end());
+                }
+            }
+            values.push_back(fingerprint(line.begin(), end));
+        }
+
+        sort_unique(values);
+        if (!numeric) {
+            mode = FINGERPRINTS;
+            elias_fano = EliasFanoSet(values);
+        } else if (!values.empty() && values.back() / 8 < values.size() * 2) { // up to 16 bits per id bitmap is worth its speed
+            mode = NUMERIC_BITSET;
+            bitset = BitSet(values);
+        } else {
+            mode = NUMERIC_ELIAS_FANO;
+            elias_fano = EliasFanoSet(values);
+        }
+    }
+
+    size_t size() const { return mode == NUMERIC_BITSET ? bitset.size() : elias_fano.size(); }
+    size_t size_in_bytes() const { return mode == NUMERIC_BITSET ? bitset.size_in_bytes() : elias_fano.size_in_bytes(); }
+
+    // all ids are decimal numbers, so next() is available
+    bool is_numeric() const { return mode != FINGERPRINTS; }
+
+    // numeric sets only
+    bool contains(uint64_t id) const {
+        assert(is_numeric());
+        return mode == NUMERIC_BITSET ? bitset.contains(id) : elias_fano.contains(id);
+    }
+
+    bool contains(const std::string& spotid) const {
+        uint64_t number = 0;
+        if (is_numeric()) {
+            return parse_number(spotid.begin(), spotid.end(), &number) && contains(number);
+        }
+        return elias_fano.contains(fingerprint(spotid.begin(), spotid.end()));
+    }
+
+    // smallest id >= x, NONE if there is no such id, numeric sets only
+    uint64_t next(uint64_t x) const {
+        assert(is_numeric());
+        return mode == NUMERIC_BITSET ? bitset.next(x) : elias_fano.next(x);
+    }
+};
@@ -0,0 +1,209 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "tests.h"
+#include "kmer_map.h"
+#include "bloom_filter.h"
+#include "contig_builder.h"
+#include "kmer_loader.h"
+#include "begins.h"
+#include <random>
+
+TEST(bloom_filter) {
+    BloomFilter<uint64_t> seen(1024);
+    ASSERT_EQUALS(seen.size_in_bytes(), 1024);
+    ASSERT(!seen.add(12345));
+    ASSERT(seen.contains(12345));
+    ASSERT(seen.add(12345));
+    ASSERT(seen.add(12345));
+    ASSERT(seen.fill_ratio() > 0);
+}
+
+struct ReadsKmers {
+    const std::vector<string> &reads;
+    int kmer_len;
+
+    template <class Lambda>
+    void operator () (Lambda &&on_kmer) {
+        for (auto& read: reads)
+            Hash<uint64_t>::for_all_hashes_do(read, kmer_len, [&](uint64_t hash) {
+                    on_kmer(hash);
+                    return true;
+                });
+    }
+};
+
+TEST(bloom_filter_two_pass) {
+    std::vector<string> reads = {
+        "AAATTTCCCGGGAAATTTCCCGGGAAATTTCCCGGGACGT",
+        "AAATTTCCCGGGAAATTTCCCGGGAAATTTCCCGGGACGT",
+        "ACGTCCCGGGAAATTTCCCGGGAAATTTCCCGGGAAATTT",
+        "TTTTGGGGCCCCAAAATTTTGGGGCCCCAAAATTTTGGGGCCCCAAAA",
+    };
+
+    typedef KmerMap<uint64_t, 32, 4> TestKmerMap;
+    TestKmerMap single_pass;
+    build_test_map(reads, single_pass);
+
+    TestKmerMap two_pass;
+    KmerLoader::load_two_pass(two_pass, 1, ReadsKmers{ reads, two_pass.kmer_len });
+    two_pass.optimize();
+
+    ASSERT(single_pass.size() > 0);
+    ASSERT_EQUALS(two_pass.size(), single_pass.size());
+    ASSERT_EQUALS(two_pass.total_weight(), single_pass.total_weight());
+    single_pass.for_every_kmer_do([&](uint64_t hash, unsigned int count) {
+            ASSERT_EQUALS(two_pass.get(hash), count);
+            ASSERT_EQUALS(two_pass.originally_reverse(hash), single_pass.originally_reverse(hash));
+            ASSERT_EQUALS(two_pass.originally_complement(hash), single_pass.originally_complement(hash));
+        });
+}
+
+TEST(claim) {
+    typedef KmerMap<uint64_t, 32, 4> TestKmerMap;
+    TestKmerMap kmers;
+    build_test_map({ "ACGTTGCAACGTTGCAACGTTGCAACGTTGCAAC", "ACGTTGCAACGTTGCAACGTTGCAACGTTGCAAC" }, kmers);
+
+    auto hash = Hash<uint64_t>::hash_of("ACGTTGCAACGTTGCAACGTTGCAACGTTGCA");
+    ASSERT_EQUALS(kmers.coverage_of(hash), 2);
+    ASSERT(kmers.claim(seq_transform<uint64_t>::to_rev_complement(hash, 32)));
+    ASSERT(!kmers.claim(hash));
+    ASSERT_EQUALS(kmers.coverage_of(hash), 0);
+    ASSERT(!kmers.claim(Hash<uint64_t>::hash_of("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA")));
+}
+
+TEST(parallel_contigs_do_not_overlap) {
+    std::vector<string> reads = {
+        "ACGTTGCATTGACCATGGTACCGATTACAGGCATCGATCGGATCCTAGCTAGGCTAACGTAGCT",
+        "ACGTTGCATTGACCATGGTACCGATTACAGGCATCGATCGGATCCTAGCTAGGCTAACGTAGCT",
+        "TTGGCCAAGGTTCCAAGGTTAACCGGTTAAGGCCTTAACCGGTATATCGCGATATGCGCATATG",
+        "TTGGCCAAGGTTCCAAGGTTAACCGGTTAAGGCCTTAACCGGTATATCGCGATATGCGCATATG",
+    };
+    typedef KmerMap<uint64_t, 32, 4> TestKmerMap;
+    TestKmerMap kmers;
+    build_test_map(reads, kmers);
+
+    std::vector<uint64_t> seeds;
+    kmers.for_every_kmer_do([&](uint64_t hash, unsigned int) { seeds.push_back(hash); });
+
+    std::vector<string> contigs;
+    #pragma omp parallel for num_threads(4)
+    for (int i = 0; i < int(seeds.size()); i++) {
+        auto contig = ContigBuilder::get_next_contig(kmers, seeds[i]);
+        #pragma omp critical (contigs)
+        if (!contig.empty())
+            contigs.push_back(contig);
+    }
+
+    TestKmerMap used;
+    for (auto &contig : contigs)
+        Hash<uint64_t>::for_all_hashes_do(contig, 32, [&](uint64_t hash) {
+                used.add(hash);
+                return true;
+            });
+
+    ASSERT_EQUALS(used.size(), seeds.size());
+    used.for_every_kmer_do([&](uint64_t hash, unsigned int count) {
+            ASSERT_EQUALS(count, 1);
+            ASSERT_EQUALS(kmers.coverage_of_no_deleted_check(hash), 2);
+        });
+}
+
+// reads of 64 bases every 8 bases of a random genome, each read twice
+static std::vector<string> genome_reads(const string &genome) {
+    std::vector<string> reads;
+    for (size_t pos = 0; pos + 64 <= genome.length(); pos += 8)
+        for (int copy = 0; copy < 2; copy++)
+            reads.push_back(genome.substr(pos, 64));
+    return reads;
+}
+
+static string random_genome(size_t len) {
+    std::mt19937 gen(1);
+    string genome;
+    for (size_t i = 0; i < len; i++)
+        genome += "ACGT"[gen() % 4];
+    return genome;
+}
+
+TEST(stitch_contigs_met_at_lost_claims) {
+    typedef KmerMap<uint64_t, 32, 4> TestKmerMap;
+    auto genome = random_genome(3000);
+    TestKmerMap kmers;
+    build_test_map(genome_reads(genome), kmers);
+    kmers.for_every_kmer_do([&](uint64_t hash, unsigned int) { kmers.claim(hash); });
+
+    // pieces overlap by kmer_len - 1, as contigs which stopped at each other's kmers
+    std::vector<string> pieces = { genome.substr(0, 1031), genome.substr(1000, 1031), genome.substr(2000) };
+    seq_transform_actg::to_rev_complement(pieces[1]);
+    auto contigs = ContigBuilder::stitch(kmers, pieces);
+    ASSERT_EQUALS(contigs.size(), 1);
+    auto reversed = contigs.front();
+    seq_transform_actg::to_rev_complement(reversed);
+    ASSERT(contigs.front() == genome || reversed == genome);
+
+    // pieces which are not next to each other stay as they are
+    contigs = ContigBuilder::stitch(kmers, { pieces[0], pieces[2] });
+    ASSERT_EQUALS(contigs.size(), 2);
+    ASSERT(contigs.front() == pieces[0]);
+    ASSERT(contigs.back() == pieces[2]);
+}
+
+TEST(contigs_do_not_depend_on_thread_count) {
+    typedef KmerMap<uint64_t, 32, 4> TestKmerMap;
+    auto genome = random_genome(3000);
+    auto reads = genome_reads(genome);
+
+    for (int threads : { 1, 2, 8 }) {
+        TestKmerMap kmers;
+        build_test_map(reads, kmers);
+        Begins<TestKmerMap> begins(kmers);
+
+        std::vector<string> pieces;
+        #pragma omp parallel num_threads(threads)
+        {
+            uint64_t hash = 0;
+            while (true) {
+                bool has_begin;
+                #pragma omp critical (begins)
+                has_begin = begins.next(&hash);
+                if (!has_begin)
+                    break;
+
+                auto contig = ContigBuilder::get_next_contig(kmers, hash);
+                #pragma omp critical (contigs)
+                if (!contig.empty())
+                    pieces.push_back(contig);
+            }
+        }
+
+        auto contigs = ContigBuilder::stitch(kmers, pieces);
+        ASSERT_EQUALS(contigs.size(), 1);
+        ASSERT_EQUALS(contigs.front().length(), genome.length());
+    }
+}
+
+TEST_MAIN();
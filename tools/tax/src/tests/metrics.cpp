@@ -0,0 +1,80 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "tests.h"
+#include "metrics.h"
+#include <thread>
+
+TEST(per_thread_counters) {
+    Metrics::reset();
+    const int THREADS = 4;
+    const int ITERATIONS = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.push_back(std::thread([]() {
+            auto& metrics = Metrics::local();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                metrics.reads++;
+                metrics.bases += 100;
+            }
+        }));
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+    Metrics::local().kmers += 7; // live thread
+    auto total = Metrics::total();
+    ASSERT_EQUALS(total.reads, uint64_t(THREADS * ITERATIONS));
+    ASSERT_EQUALS(total.bases, uint64_t(THREADS * ITERATIONS) * 100);
+    ASSERT_EQUALS(total.kmers, uint64_t(7));
+
+    Metrics::reset();
+    ASSERT_EQUALS(Metrics::total().reads, uint64_t(0));
+    ASSERT_EQUALS(Metrics::local().kmers, uint64_t(0));
+}
+
+TEST(timer) {
+    uint64_t ns = 0;
+    {
+        Metrics::Timer timer(ns);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT(ns >= 2000000);
+}
+
+TEST(to_json) {
+    Metrics m;
+    m.reads = 3;
+    m.match_ns = 5000000;
+    auto json = m.to_json(1000000000);
+    ASSERT(json.find("\"reads\":3,") != std::string::npos);
+    ASSERT(json.find("\"match_ms\":5,") != std::string::npos);
+    ASSERT(json.find("\"reads_per_sec\":3,") != std::string::npos);
+    ASSERT(json.front() == '{' && json.back() == '}');
+}
+
+TEST_MAIN();
@@ -0,0 +1,117 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "tests.h"
+#include "mismatch_index.h"
+#include <random>
+
+struct KmerTax {
+    uint64_t kmer;
+    int tax_id;
+    bool operator < (const KmerTax& x) const { return kmer < x.kmer; }
+};
+
+static uint64_t random_kmer(std::mt19937_64& rnd, int kmer_len) {
+    return rnd() & ((uint64_t(1) << (kmer_len * 2 - 1) << 1) - 1);
+}
+
+static uint64_t mutate(std::mt19937_64& rnd, uint64_t kmer, int kmer_len, int mismatches) {
+    std::vector<int> positions;
+    while (int(positions.size()) < mismatches) {
+        int pos = rnd() % kmer_len;
+        if (std::find(positions.begin(), positions.end(), pos) == positions.end()) {
+            positions.push_back(pos);
+            kmer ^= uint64_t(1 + rnd() % 3) << (pos * 2);
+        }
+    }
+    return kmer;
+}
+
+static int distance(uint64_t a, uint64_t b, int kmer_len) {
+    int d = 0;
+    for (int i = 0; i < kmer_len; ++i, a >>= 2, b >>= 2) {
+        d += (a & 3) != (b & 3);
+    }
+    return d;
+}
+
+static size_t brute_force(const std::vector<KmerTax>& db, uint64_t kmer, int kmer_len, int max_mismatches) {
+    const uint64_t rc = seq_transform<uint64_t>::to_rev_complement(kmer, kmer_len);
+    size_t best = size_t(-1);
+    int best_distance = max_mismatches + 1;
+    for (size_t i = 0; i < db.size(); ++i) {
+        const int d = std::min(distance(db[i].kmer, kmer, kmer_len), distance(db[i].kmer, rc, kmer_len));
+        if (d < best_distance) {
+            best_distance = d;
+            best = i;
+        }
+    }
+    return best;
+}
+
+TEST(mismatch_index_vs_brute_force) {
+    std::mt19937_64 rnd(1);
+    for (int kmer_len: {32, 25, 12}) {
+        std::vector<KmerTax> db;
+        for (int i = 0; i < 2000; ++i) {
+            auto kmer = random_kmer(rnd, kmer_len);
+            db.push_back(KmerTax{seq_transform<uint64_t>::min_hash_variant(kmer, kmer_len), i});
+        }
+        std::sort(db.begin(), db.end());
+        db.erase(std::unique(db.begin(), db.end(), [](const KmerTax& a, const KmerTax& b) { return a.kmer == b.kmer; }), db.end());
+
+        for (int max_mismatches = 1; max_mismatches <= 3; ++max_mismatches) {
+            MismatchIndex<uint64_t, std::vector<KmerTax>> index(db, kmer_len, max_mismatches);
+            ASSERT(index.size_in_bytes() >= db.size() * sizeof(uint32_t) * (max_mismatches + 1));
+            for (int i = 0; i < 2000; ++i) {
+                auto& source = db[rnd() % db.size()];
+                auto kmer = mutate(rnd, source.kmer, kmer_len, rnd() % (max_mismatches + 2));
+                if (rnd() % 2) {
+                    kmer = seq_transform<uint64_t>::to_rev_complement(kmer, kmer_len);
+                }
+                int mismatches = -1;
+                auto found = index.find(kmer, &mismatches);
+                auto expected = brute_force(db, kmer, kmer_len, max_mismatches);
+                ASSERT_EQUALS(found, expected);
+                ASSERT((found == size_t(-1)) == (mismatches > max_mismatches));
+            }
+        }
+    }
+}
+
+TEST(mismatch_index_invalid) {
+    std::vector<KmerTax> db;
+    bool thrown = false;
+    try {
+        MismatchIndex<uint64_t, std::vector<KmerTax>> index(db, 32, 4);
+    } catch (std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+TEST_MAIN();
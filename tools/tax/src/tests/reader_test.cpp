@@ -30,6 +30,7 @@
 
 #include "vdb_reader.h"
 #include "fasta_reader.h"
+#include "parallel_fasta_reader.h"
 #include "mt_reader.h"
 #include "aux_reader.h"
 
@@ -205,6 +206,170 @@ TEST(fasta_reader) {
     ASSERT(_unix == dos);
 }
 
+static void write_test_file(const std::vector<Reader::Fragment>& fragments, const std::string& path, bool fastq) {
+    std::string text;
+    for (auto& f: fragments) {
+        if (fastq) {
+            text += "@" + f.spotid + "\n" + f.bases + "\n+\n#" + std::string(f.bases.size() - 1, 'I') + "\n";
+        } else {
+            text += ">" + f.spotid + "\n" + f.bases + "\n";
+        }
+    }
+    const bool gzipped = path.substr(path.size() - 3) == ".gz";
+    gzFile file = gzopen(path.c_str(), gzipped ? "wb" : "wbT");
+    ASSERT(file);
+    ASSERT_EQUALS(gzwrite(file, text.data(), unsigned(text.size())), int(text.size()));
+    gzclose(file);
+}
+
+TEST(parallel_fasta_reader) {
+    auto reference = Helper<FastaReader>::read_all("./tests/data/SRR1068106.fasta");
+    for (int thread_count = 1; thread_count <= 16; thread_count <<= 2) {
+        for (size_t block_size = 1; block_size <= 1024 * 1024; block_size <<= 5) {
+            std::cout << "checking parallel fasta reader with thread_count=" << thread_count << " block_size=" << block_size << std::endl;
+            ParallelFastaReader reader("./tests/data/SRR1068106.fasta", thread_count, false, block_size);
+            ASSERT(read_all(&reader) == reference);
+            ASSERT(reader.stats() == Reader::SourceStats(226));
+        }
+    }
+    ASSERT(Helper<ParallelFastaReader>::read_all("./tests/data/SRR1068106.fasta.dos", 4) == reference);
+    ASSERT(Helper<ParallelFastaReader>::read_all("./tests/data/multiline_reads.fasta", 4, false, 16) == Helper<FastaReader>::read_all("./tests/data/multiline_reads.fasta"));
+
+    const std::vector<std::string> paths = { "./tests/data/tmp_SRR1068106.fasta.gz", "./tests/data/tmp_SRR1068106.fastq", "./tests/data/tmp_SRR1068106.fastq.gz" };
+    for (auto& path: paths) {
+        ASSERT(ParallelFastaReader::is_supported(path));
+        const bool fastq = path.find(".fastq") != std::string::npos;
+        write_test_file(reference, path, fastq);
+        ASSERT(Helper<ParallelFastaReader>::read_all(path, 4, false, 1000) == reference);
+
+        auto with_qual = Helper<ParallelFastaReader>::read_all_bases(path, 4, true, 1000);
+        ASSERT_EQUALS(with_qual.size(), reference.size());
+        ASSERT_EQUALS(with_qual[0][0], fastq ? '!' : reference[0].bases[0]);
+        ASSERT_EQUALS(with_qual[0].substr(1), reference[0].bases.substr(1));
+
+        Reader::Params params;
+        params.thread_count = 2;
+        auto factory = read_all(Reader::create(path, params));
+        ASSERT_EQUALS(factory.size(), reference.size());
+        std::remove(path.c_str());
+    }
+}
+
+TEST(fasta_reader_ranges) {
+    const char* paths[] = { "./tests/data/SRR1068106.fasta", "./tests/data/SRR1068106.fasta.dos", "./tests/data/multiline_reads.fasta" };
+    for (auto path: paths) {
+        auto reference = Helper<FastaReader>::read_all(path);
+        for (size_t range_size = 1; range_size <= 1024 * 1024; range_size <<= 3) {
+            FastaReader reader(path);
+            std::vector<Reader::Fragment> result;
+            for (size_t first = 0; first < reader.range_units(); first += range_size) {
+                reader.set_range(first, std::min(range_size, reader.range_units() - first));
+                Reader::Fragment f;
+                while (reader.read(&f)) {
+                    result.push_back(f);
+                }
+            }
+            ASSERT(result == reference);
+            ASSERT_EQUALS(reader.stats().spot_count, reference.size());
+        }
+
+        MTReader<FastaReader> mt_reader(4, 16, path);
+        auto mt_result = read_all(&mt_reader);
+        ASSERT_EQUALS(mt_result.size(), reference.size());
+        ASSERT(mt_reader.stats() == Reader::SourceStats(reference.size()));
+    }
+}
+
+TEST(fasta_reader_random_order) {
+    const char* path = "./tests/data/SRR1068106.fasta";
+    auto reference = Helper<FastaReader>::read_all(path);
+    std::sort(reference.begin(), reference.end(), FragmentSort());
+
+    for (size_t thread_count: {1, 4}) {
+        MTReader<FastaReader> reader(RangeOrder(true, 1), thread_count, 16, path);
+        auto result = read_all(&reader);
+        ASSERT(result != Helper<FastaReader>::read_all(path)); // shuffled
+        std::sort(result.begin(), result.end(), FragmentSort());
+        ASSERT(result == reference);
+        ASSERT(reader.stats() == Reader::SourceStats(reference.size()));
+        ASSERT(reader.random_order());
+        ASSERT_EQUALS(reader.sampled_ranges(), reference.size()); // ranges are smaller than records
+    }
+
+    MTReader<FastaReader> sequential_reader(4, 16, path);
+    ASSERT(!sequential_reader.random_order());
+
+    MTReader<FastaReader> sampling_reader(RangeOrder(false, 0.25f), 2, 16, path);
+    auto sample = read_all(&sampling_reader);
+    ASSERT(sample.size() > reference.size() / 8 && sample.size() < reference.size() / 2);
+    std::sort(sample.begin(), sample.end(), FragmentSort());
+    ASSERT(std::includes(reference.begin(), reference.end(), sample.begin(), sample.end(), FragmentSort()));
+    ASSERT(sampling_reader.stats() == Reader::SourceStats(sample.size()));
+
+    Reader::Params params;
+    params.sample_fraction = 0.25f;
+    ASSERT_EQUALS(read_all(Reader::create(path, params)).size(), sample.size());
+
+    Reader::Params screening_params;
+    screening_params.random_order = true;
+    screening_params.split_non_atgc = true;
+    screening_params.random_ranges = 16;
+    auto screening_reader = Reader::create(path, screening_params);
+    ASSERT(screening_reader->random_order());
+    Reader::Chunk chunk;
+    size_t sampled_ranges = 0;
+    while (screening_reader->read_many(chunk)) {
+        ASSERT(screening_reader->sampled_ranges() >= sampled_ranges);
+        sampled_ranges = screening_reader->sampled_ranges();
+    }
+    ASSERT(sampled_ranges >= 16 && sampled_ranges <= reference.size()); // all ranges, at least 16, none empty
+}
+
+template <typename ReaderPtr>
+static std::vector<Reader::Fragment> read_all_chunks(ReaderPtr reader) {
+    std::vector<Reader::Fragment> result;
+    Reader::Chunk chunk;
+    while (reader->read_many(chunk)) {
+        ASSERT(!chunk.empty());
+        result.insert(result.end(), chunk.begin(), chunk.end());
+    }
+    ASSERT(chunk.empty());
+    return result;
+}
+
+TEST(read_many_chunk_reuse) {
+    Reader::Chunk chunk;
+    chunk.add().bases = "ACGT";
+    chunk.clear();
+    ASSERT(chunk.empty());
+    ASSERT_EQUALS(chunk.add().bases, "ACGT"); // cleared fragments keep their buffers
+    ASSERT_EQUALS(chunk.size(), 1);
+
+    const char* path = "./tests/data/multiline_reads.fasta";
+    auto reference = Helper<FastaReader>::read_all(path);
+    {
+        FastaReader reader(path);
+        ASSERT(read_all_chunks(&reader) == reference);
+    }
+    {
+        ParallelFastaReader reader(path, 4, false, 16);
+        ASSERT(read_all_chunks(&reader) == reference);
+    }
+    {
+        MTReader<FastaReader> reader(4, 2, path);
+        auto result = read_all_chunks(&reader);
+        std::sort(result.begin(), result.end(), FragmentSort());
+        auto sorted_reference = reference;
+        std::sort(sorted_reference.begin(), sorted_reference.end(), FragmentSort());
+        ASSERT(result == sorted_reference);
+    }
+    {
+        SplittingReader<ParallelFastaReader> splitting(path, 2, false, 16);
+        SplittingReader<FastaReader> splitting_reference(path);
+        ASSERT(read_all_chunks(&splitting) == read_all(&splitting_reference));
+    }
+}
+
 TEST(vdb_fasta_equal) {
     {
         auto vdb = Helper<VdbReader>::read_all_bases("./tests/data/SRR1068106");
@@ -218,6 +383,23 @@ TEST(vdb_fasta_equal) {
     }
 }
 
+TEST(vdb_blob_reader) {
+    auto expected = Helper<VdbReader>::read_all("./tests/data/SRR1068106");
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [](const Reader::Fragment& f) { return f.bases.empty(); }), expected.end());
+    ASSERT(Helper<VdbBlobReader>::read_all("./tests/data/SRR1068106") == expected);
+
+    MTReader<VdbBlobReader> mt_reader(1, 16, "./tests/data/SRR1068106");
+    ASSERT(read_all(&mt_reader) == expected);
+
+    Reader::Params params;
+    auto factory = read_all_bases(Reader::create("./tests/data/SRR1068106", params));
+    params.vdb_blobs = true;
+    auto factory_blobs = read_all_bases(Reader::create("./tests/data/SRR1068106", params));
+    std::sort(factory.begin(), factory.end());
+    std::sort(factory_blobs.begin(), factory_blobs.end());
+    ASSERT(factory_blobs == factory);
+}
+
 TEST(vdb_qualities_reader) {
     auto no_qual = Helper<VdbReader>::read_all_bases("./tests/data/SRR1068106", false);
     auto with_qual = Helper<VdbReader>::read_all_bases("./tests/data/SRR1068106", true);
@@ -240,11 +422,31 @@ void test_aligned_vdb_reader(const char* path, bool read_qualities) {
     ASSERT(vdb == aligned);
     ASSERT(VdbReader(path, read_qualities).stats() == AlignedVdbReader(path, read_qualities).stats());
 }
+static void test_aligned_vdb_reader_ranges(const char* path) {
+    auto reference = Helper<AlignedVdbReader>::read_all(path);
+    std::sort(reference.begin(), reference.end(), FragmentSort());
+    for (size_t range_size = 1; range_size <= 4096; range_size <<= 4) {
+        AlignedVdbReader reader(path);
+        std::vector<Reader::Fragment> result;
+        for (size_t first = 0; first < reader.range_units(); first += range_size) {
+            reader.set_range(first, std::min(range_size, reader.range_units() - first));
+            Reader::Fragment f;
+            while (reader.read(&f)) {
+                result.push_back(f);
+            }
+        }
+        std::sort(result.begin(), result.end(), FragmentSort());
+        ASSERT(result == reference);
+    }
+}
+
 TEST(aligned_vdb_reader) {
     test_aligned_vdb_reader("./tests/data/SRR1068106", false); // has aligned and unaligned single reads
     test_aligned_vdb_reader("./tests/data/SRR1068106", true);
     test_aligned_vdb_reader("./tests/data/ERR333883", false); // has aligned, unaligned and partially aligned _paired_ reads
     test_aligned_vdb_reader("./tests/data/ERR333883", true);
+    test_aligned_vdb_reader_ranges("./tests/data/SRR1068106");
+    test_aligned_vdb_reader_ranges("./tests/data/ERR333883");
 }
 
 template <typename ReaderType>
@@ -264,6 +466,7 @@ TEST(mt_reader) {
     test_mt_reader<FastaReader>("fasta", "./tests/data/SRR1068106.fasta");
     test_mt_reader<VdbReader>("vdb", "./tests/data/SRR1068106");
     test_mt_reader<AlignedVdbReader>("aligned vdb", "./tests/data/SRR1068106");
+    test_mt_reader<AlignedVdbReader>("aligned vdb", "./tests/data/ERR333883");
 }
 
 TEST(filtering_reader) {
@@ -301,6 +504,21 @@ TEST(filtering_reader) {
         ASSERT(file_result == file_expected);
         ASSERT_EQUALS(stats.spot_count, 226);
         ASSERT_EQUALS(stats.expected_spot_count, 5);
+
+        { // same rows, the rest of the run is skipped
+            auto rows = std::make_shared<SpotSet>("./tests/data/filter.spots");
+            ASSERT(rows->is_numeric());
+            SelectedRowsReader<VdbReader> reader(rows, "./tests/data/SRR1068106");
+            ASSERT(read_all(&reader) == file_expected);
+            ASSERT_EQUALS(reader.stats().expected_spot_count, 5);
+
+            MTReader<SelectedRowsReader<VdbReader>> mt_reader(4, 2, rows, "./tests/data/SRR1068106");
+            auto mt_result = read_all(&mt_reader);
+            std::sort(mt_result.begin(), mt_result.end(), FragmentSort());
+            auto sorted_expected = file_expected;
+            std::sort(sorted_expected.begin(), sorted_expected.end(), FragmentSort());
+            ASSERT(mt_result == sorted_expected);
+        }
     }
 
     {
@@ -401,7 +619,7 @@ void print_stats(const char* path) {
 void test_read(const char* path) {
     std::cerr << "Test reading: " << path << std::endl;
     auto reader = Reader::create(path);
-    std::vector<Reader::Fragment> chunk;
+    Reader::Chunk chunk;
     int percent = -1;
     while (reader->read_many(chunk)) {
         ASSERT(reader->progress() >= 0 && reader->progress() <= 1);
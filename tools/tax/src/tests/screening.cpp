@@ -0,0 +1,103 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "tests.h"
+#include "screening.h"
+#include <random>
+
+TEST(screening_decisions) {
+    const size_t ranges = ScreeningTest::MIN_RANGES;
+    ScreeningTest above(0.1);
+    ASSERT_EQUALS(above.add(100000, 50000, ranges / 2), ScreeningTest::UNDECIDED); // too few ranges
+    ASSERT_EQUALS(above.add(100000, 50000, ranges), ScreeningTest::PRESENT);
+    ASSERT_EQUALS(above.add(1000, 0, ranges), ScreeningTest::PRESENT); // decision sticks
+
+    ScreeningTest below(0.01);
+    ASSERT_EQUALS(below.add(ranges * 10, 0, ranges * 10), ScreeningTest::ABSENT);
+
+    ScreeningTest close(0.5);
+    ASSERT_EQUALS(close.add(ranges, ranges / 2, ranges), ScreeningTest::UNDECIDED);
+}
+
+TEST(screening_interval) {
+    ScreeningTest test(0.5);
+    double low = 0, high = 0;
+    test.interval(&low, &high);
+    ASSERT(low == 0 && high == 1);
+
+    test.add(100000, 30000, 100000);
+    test.interval(&low, &high);
+    ASSERT(low < 0.3 && high > 0.3);
+    ASSERT(high - low < 0.02);
+
+    // same reads in fewer ranges: wider interval
+    ScreeningTest clustered(0.5);
+    clustered.add(100000, 30000, 1000);
+    double clustered_low = 0, clustered_high = 0;
+    clustered.interval(&clustered_low, &clustered_high);
+    ASSERT(clustered_low < low && clustered_high > high);
+}
+
+// true fraction at threshold: any decision is wrong, checks after every 1024 spots as aligns_to does
+// spots_per_range spots of a range are read together
+template <class RangeFraction>
+static int wrong_decisions(int spots_per_range, RangeFraction range_fraction)
+{
+    std::mt19937_64 rnd(1);
+    int wrong = 0;
+    for (int run = 0; run < 200; ++run) {
+        ScreeningTest test(0.2);
+        size_t ranges = 0;
+        for (int chunk = 0; chunk < 200 && test.decision == ScreeningTest::UNDECIDED; ++chunk) {
+            size_t hits = 0;
+            for (int range = 0; range < 1024 / spots_per_range; ++range) {
+                std::bernoulli_distribution matched(range_fraction(rnd));
+                for (int i = 0; i < spots_per_range; ++i) {
+                    hits += matched(rnd);
+                }
+                ranges++;
+            }
+            test.add(1024, hits, ranges);
+        }
+        wrong += test.decision != ScreeningTest::UNDECIDED;
+    }
+    return wrong;
+}
+
+TEST(screening_false_decisions_are_rare) {
+    // independent spots
+    ASSERT(wrong_decisions(1, [](std::mt19937_64&) { return 0.2; }) <= 2);
+}
+
+TEST(screening_clustered_false_decisions_are_rare) {
+    // all spots of a range match or not together, the worst case for a clustered sample
+    ASSERT(wrong_decisions(16, [](std::mt19937_64& rnd) { return std::bernoulli_distribution(0.2)(rnd) ? 1.0 : 0.0; }) <= 2);
+    // ranges of very different content
+    ASSERT(wrong_decisions(64, [](std::mt19937_64& rnd) { return std::uniform_real_distribution<double>(0, 0.4)(rnd); }) <= 2);
+}
+
+TEST_MAIN();
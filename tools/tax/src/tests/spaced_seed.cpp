@@ -0,0 +1,155 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include <stdint.h>
+typedef uint64_t hash_t;
+
+#include "tests.h"
+#include "spaced_seed.h"
+#include "seq_transform.h"
+#include "dbs.h"
+#include <random>
+#include <cstdio>
+
+static std::string random_seq(std::mt19937_64& rnd, size_t len) {
+    std::string s;
+    for (size_t i = 0; i < len; ++i) {
+        s += "ACGT"[rnd() % 4];
+    }
+    return s;
+}
+
+static std::string compact(const std::string& s, const std::string& seed) {
+    std::string key;
+    for (size_t i = 0; i < seed.size(); ++i) {
+        if (seed[i] == '1') {
+            key += s[i];
+        }
+    }
+    return key;
+}
+
+static std::string reverse_complement(std::string s) {
+    seq_transform_actg::to_rev_complement(s);
+    return s;
+}
+
+template <class hash_t, class window_t>
+static void check_seed(const std::string& seed) {
+    std::mt19937_64 rnd(seed.size());
+    SpacedKmers<hash_t, window_t> kmers(seed);
+    ASSERT_EQUALS(kmers.span(), int(seed.size()));
+    for (int i = 0; i < 200; ++i) {
+        auto s = random_seq(rnd, seed.size());
+        auto key = kmers.key_of(s);
+        ASSERT(key == Hash<hash_t>::hash_of(compact(s, seed)));
+        // symmetric seed: key of reverse complement is reverse complement of key
+        ASSERT(kmers.key_of(reverse_complement(s)) == seq_transform<hash_t>::to_rev_complement(key, kmers.key_len()));
+    }
+
+    auto s = random_seq(rnd, seed.size() + 20);
+    size_t pos = 0;
+    kmers.for_all_hashes_do(s, [&](hash_t key) {
+        ASSERT(key == kmers.key_of(s.substr(pos++, seed.size())));
+        return true;
+    });
+    ASSERT_EQUALS(pos, size_t(21));
+}
+
+TEST(spaced_seed_key_of) {
+    check_seed<uint64_t, uint64_t>("11011");
+    check_seed<uint64_t, uint64_t>("1101101011011");
+    check_seed<uint64_t, uint64_t>("11111111111111011011111111111111"); // span 32
+    check_seed<uint64_t, __uint128_t>("1110110111011011101111011101101110110111"); // span 40, weight 30
+}
+
+TEST(spaced_seed_128_bit_keys) {
+    check_seed<__uint128_t, __uint128_t>("111111111111110111111111111110011111111111111011111111111111"); // weight 56
+}
+
+TEST(spaced_seed_invalid) {
+    const char* invalid[] = { "", "11", "111", "1101", "0110", "1121", "1101001" };
+    for (auto seed : invalid) {
+        bool thrown = false;
+        try {
+            SpacedKmers<uint64_t, uint64_t> kmers(seed);
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+}
+
+TEST(dbs_format_round_trip) {
+    const std::string filename = "spaced_seed_test.dbs";
+    {
+        std::vector<DBS::KmerTax> kmers = { DBS::KmerTax(1, 10), DBS::KmerTax(5, 20) };
+        DBSIO::save_dbs(filename, kmers, 32);
+        std::vector<DBS::KmerTax> loaded;
+        ASSERT_EQUALS(DBSIO::load_dbs(filename, loaded), size_t(32));
+        ASSERT_EQUALS(loaded.size(), size_t(2));
+        ASSERT_EQUALS(loaded[1].tax_id, 20);
+        ASSERT(DBSIO::load_format(filename).is_contiguous());
+        ASSERT_EQUALS(DBSIO::load_format(filename).version(), DBSIO::VERSION);
+    }
+    {
+        typedef DBS::KmerTaxOf<__uint128_t> KmerTax;
+        std::vector<KmerTax> kmers = { KmerTax(__uint128_t(1) << 100, 10) };
+        DBSIO::Format format(56, sizeof(__uint128_t), "111111111111110111111111111110011111111111111011111111111111");
+        DBSIO::save_dbs(filename, kmers, format);
+
+        auto loaded_format = DBSIO::load_format(filename);
+        ASSERT_EQUALS(loaded_format.version(), DBSIO::SEED_VERSION);
+        ASSERT_EQUALS(loaded_format.key_bytes, sizeof(__uint128_t));
+        ASSERT_EQUALS(loaded_format.seed, format.seed);
+
+        std::vector<KmerTax> loaded;
+        ASSERT_EQUALS(DBSIO::load_dbs(filename, loaded, &loaded_format), size_t(56));
+        ASSERT(loaded[0].kmer == kmers[0].kmer);
+
+        // wrong key size or no format for spaced seed
+        bool thrown = false;
+        try {
+            std::vector<DBS::KmerTax> wrong;
+            DBSIO::load_dbs(filename, wrong, &loaded_format);
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+
+        thrown = false;
+        try {
+            DBSIO::load_dbs(filename, loaded);
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_MAIN();
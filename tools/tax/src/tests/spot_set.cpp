@@ -0,0 +1,145 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "tests.h"
+#include "spot_set.h"
+#include <fstream>
+#include <set>
+#include <random>
+#include <cstdio>
+
+static void write_lines(const std::string& path, const std::vector<std::string>& lines) {
+    std::ofstream f(path);
+    for (auto& line: lines) {
+        f << line << std::endl;
+    }
+}
+
+static std::string to_str(uint64_t x) {
+    return std::to_string((unsigned long long)x);
+}
+
+template <typename Set>
+static void check_query(const Set& set, const std::set<uint64_t>& reference, uint64_t x) {
+    ASSERT_EQUALS(set.contains(x), reference.count(x) > 0);
+    auto it = reference.lower_bound(x);
+    const uint64_t expected_next = it == reference.end() ? uint64_t(-1) : *it;
+    ASSERT_EQUALS(set.next(x), expected_next);
+}
+
+// all queries up to 1000, around every value and some random ones up to max_query
+template <typename Set>
+static void check_against_reference(const Set& set, const std::set<uint64_t>& reference, uint64_t max_query, std::mt19937_64& rnd) {
+    ASSERT_EQUALS(set.size(), reference.size());
+    for (uint64_t x = 0; x <= std::min(max_query, uint64_t(1000)); ++x) {
+        check_query(set, reference, x);
+    }
+    for (auto value: reference) {
+        check_query(set, reference, value - 1);
+        check_query(set, reference, value);
+        check_query(set, reference, value + 1);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        check_query(set, reference, rnd() % (max_query + 1));
+    }
+}
+
+TEST(elias_fano_and_bitset) {
+    std::mt19937_64 rnd(1);
+    for (size_t count: {0, 1, 2, 100, 1000, 5000}) {
+        for (uint64_t universe: {1000, 100000, 10000000}) {
+            std::set<uint64_t> reference;
+            while (reference.size() < count && reference.size() < universe) {
+                reference.insert(rnd() % universe);
+            }
+            std::vector<uint64_t> values(reference.begin(), reference.end());
+            const uint64_t max_query = universe + 10;
+            check_against_reference(EliasFanoSet(values), reference, max_query, rnd);
+            check_against_reference(BitSet(values), reference, max_query, rnd);
+        }
+    }
+
+    std::vector<uint64_t> big = { 1, uint64_t(1) << 40, uint64_t(-2) };
+    EliasFanoSet ef(big);
+    ASSERT(ef.contains(1));
+    ASSERT(ef.contains(uint64_t(1) << 40));
+    ASSERT(ef.contains(uint64_t(-2)));
+    ASSERT(!ef.contains(2));
+    ASSERT_EQUALS(ef.next(2), uint64_t(1) << 40);
+}
+
+TEST(spot_set_numeric) {
+    const std::string path = "./tmp_spot_set_numeric.spots";
+    write_lines(path, { "5.1", "5.2", "123", "", "7\r", "100000" });
+    SpotSet spots(path);
+    std::remove(path.c_str());
+
+    ASSERT(spots.is_numeric());
+    ASSERT_EQUALS(spots.size(), 4);
+    ASSERT(spots.contains(std::string("5")));
+    ASSERT(spots.contains(std::string("7")));
+    ASSERT(spots.contains(std::string("123")));
+    ASSERT(spots.contains(std::string("100000")));
+    ASSERT(!spots.contains(std::string("6")));
+    ASSERT(!spots.contains(std::string("007")));
+    ASSERT(!spots.contains(std::string("5.1")));
+    ASSERT(!spots.contains(std::string("SRR1.5")));
+    ASSERT_EQUALS(spots.next(8), 123);
+    ASSERT_EQUALS(spots.next(124), 100000);
+    ASSERT_EQUALS(spots.next(100001), uint64_t(-1));
+
+    const std::string dense_path = "./tmp_spot_set_dense.spots";
+    std::vector<std::string> lines;
+    for (int i = 1; i <= 1000; i += 2) {
+        lines.push_back(to_str(i));
+    }
+    write_lines(dense_path, lines);
+    SpotSet dense(dense_path);
+    std::remove(dense_path.c_str());
+    ASSERT(dense.is_numeric());
+    ASSERT(dense.size_in_bytes() <= 128);
+    ASSERT(dense.contains(uint64_t(999)));
+    ASSERT(!dense.contains(uint64_t(1000)));
+}
+
+TEST(spot_set_fingerprints) {
+    const std::string path = "./tmp_spot_set_strings.spots";
+    write_lines(path, { "12", "SRR1068106.1", "read_x", "007" });
+    SpotSet spots(path);
+    std::remove(path.c_str());
+
+    ASSERT(!spots.is_numeric());
+    ASSERT_EQUALS(spots.size(), 4);
+    ASSERT(spots.contains(std::string("12")));
+    ASSERT(spots.contains(std::string("SRR1068106")));
+    ASSERT(spots.contains(std::string("read_x")));
+    ASSERT(spots.contains(std::string("007")));
+    ASSERT(!spots.contains(std::string("7")));
+    ASSERT(!spots.contains(std::string("SRR1068106.1")));
+    ASSERT(!spots.contains(std::string("read_y")));
+}
+
+TEST_MAIN();
@@ -33,7 +33,7 @@
 #include <ngs/ReadCollection.hpp>
 #include <ngs/ReadIterator.hpp>
 #include <ngs/Read.hpp>
-#include <klib/printf.h>
+#include <ngs-vdb/inc/NGS-VDB.hpp>
 
 class BaseVdbReader: public Reader {
 protected:
@@ -47,6 +47,18 @@ protected:
         , spot_idx(0)
     {}
 
+    // decimal spot id without printf and without reallocating spotid
+    static void assign_number(std::string& s, size_t number) {
+        char buffer[24];
+        char* end = buffer + sizeof(buffer);
+        char* p = end;
+        do {
+            *--p = char('0' + number % 10);
+            number /= 10;
+        } while (number);
+        s.assign(p, end);
+    }
+
     static void apply_qualities(std::string& bases, const ngs::Fragment& fragment) {
         auto qualities = fragment.getFragmentQualities();
         assert(bases.size() == qualities.size());
@@ -74,11 +86,7 @@ protected:
                 // real spotid is way too slow, using index hack
                 //auto spotid = it.getReadId();
                 //output->spotid.assign(spotid.data(), spotid.size());
-                char buffer[32];
-                size_t written;
-                string_printf(buffer, sizeof(buffer), &written, "%zd", numeric_spot_id);
-                assert(written < sizeof(buffer));
-                output->spotid = buffer;
+                assign_number(output->spotid, numeric_spot_id);
             } else {
                 auto spotid = fragment.getReadId();
                 // leaving only last part of dot-separated spot it
@@ -150,6 +158,20 @@ public:
 
     SourceStats stats() const override { return stats_for_category(category); }
 
+    // seekable reader interface, see MTReader
+    // range is in rows, reader returns fragments of reads with row ids in [first + 1, first + count]
+    size_t range_units() const { return run.getReadCount(ngs::Read::all); }
+
+    void set_range(size_t first, size_t count) {
+        it = run.getReadRange(first + 1, count, category);
+        spot_idx = first;
+        eof = !it.nextRead();
+    }
+
+    static SourceStats merge_range_stats(const std::vector<SourceStats>& stats) {
+        return stats.front(); // stats are taken from run, not from reading
+    }
+
     float progress() const override {
         return spot_count ? float(spot_idx) / spot_count : 1;
     }
@@ -173,6 +195,62 @@ public:
     }
 };
 
+// reads bases straight from READ column blobs, no per read ngs calls
+// all biological fragments of all reads, same spot ids as VdbReader, no qualities
+// empty fragments take no space in blobs, so unlike VdbReader they are not returned
+// not seekable, use MTReader with one thread to decode blobs in background
+class VdbBlobReader final: public BaseVdbReader {
+private:
+    ncbi::ngs::vdb::FragmentBlobIterator blobs;
+    std::unique_ptr<ncbi::ngs::vdb::FragmentBlob> blob;
+    uint64_t offset; // in current blob
+    size_t spot_count;
+
+public:
+    VdbBlobReader(const std::string& acc)
+        : BaseVdbReader(acc, false)
+        , blobs(ncbi::ngs::vdb::VdbReadCollection(run).getFragmentBlobs())
+        , offset(0)
+    {
+        spot_count = run.getReadCount(ngs::Read::all);
+    }
+
+    SourceStats stats() const override { return stats_for_category(ngs::Read::all); }
+
+    float progress() const override {
+        return spot_count ? std::min(1.0f, float(spot_idx) / spot_count) : 1;
+    }
+
+    bool read(Fragment* output) override {
+        while (true) {
+            if (!blob || offset >= blob->Size()) {
+                if (!blobs.hasMore()) {
+                    spot_idx = spot_count;
+                    return false;
+                }
+                blob.reset(new ncbi::ngs::vdb::FragmentBlob(blobs.nextBlob()));
+                offset = 0;
+            }
+
+            int64_t row = 0;
+            uint64_t start = 0;
+            uint64_t length = 0;
+            int32_t fragment = 0;
+            blob->GetFragmentRow(offset, &row, &start, &length, &fragment);
+            offset = start + length;
+            spot_idx = size_t(row - 1);
+            if (fragment < 0) { // technical
+                continue;
+            }
+            if (output) {
+                output->bases.assign(blob->Data() + start, length);
+                assign_number(output->spotid, size_t(row));
+            }
+            return true;
+        }
+    }
+};
+
 class AlignedVdbReader final: public BaseVdbReader {
 private:
     enum State {
@@ -189,6 +267,9 @@ private:
     size_t alignment_idx;
     size_t alignment_count;
     size_t spot_count;
+    // false if current range has no alignments / reads, iterators are stale then
+    bool alignments_in_range;
+    bool reads_in_range;
 
 public:
 	AlignedVdbReader(const std::string& acc, bool read_qualities = false)
@@ -198,6 +279,8 @@ public:
         , uit(run.getReads(ngs::Read::unaligned))
         , state(READING_ALIGNMNETS)
         , alignment_idx(0)
+        , alignments_in_range(true)
+        , reads_in_range(true)
     {
         spot_count = run.getReadCount() - run.getReadCount(ngs::Read::fullyAligned);
         alignment_count = run.getAlignmentCount(ngs::Alignment::primaryAlignment);
@@ -205,6 +288,34 @@ public:
 
     SourceStats stats() const override { return stats_for_category(ngs::Read::ReadCategory::all); }
 
+    // seekable reader interface, see MTReader
+    // units are primary alignment rows followed by read rows:
+    // [0, alignment_count) - primary alignments, [alignment_count, alignment_count + rows) - unaligned fragments of reads
+    size_t range_units() const { return alignment_count + run.getReadCount(ngs::Read::all); }
+
+    void set_range(size_t first, size_t count) {
+        const size_t end = first + count;
+        alignments_in_range = first < alignment_count;
+        if (alignments_in_range) {
+            alit = run.getAlignmentRange(first + 1, std::min(end, alignment_count) - first, ngs::Alignment::primaryAlignment);
+        }
+        alignment_idx = std::min(first, alignment_count);
+
+        const size_t first_row = std::max(first, alignment_count) - alignment_count;
+        const size_t end_row = std::max(end, alignment_count) - alignment_count;
+        reads_in_range = first_row < end_row;
+        if (reads_in_range) {
+            pit = run.getReadRange(first_row + 1, end_row - first_row, ngs::Read::partiallyAligned);
+            uit = run.getReadRange(first_row + 1, end_row - first_row, ngs::Read::unaligned);
+        }
+        spot_idx = first_row;
+        state = READING_ALIGNMNETS;
+    }
+
+    static SourceStats merge_range_stats(const std::vector<SourceStats>& stats) {
+        return stats.front(); // stats are taken from run, not from reading
+    }
+
     float progress() const override {
         const size_t current = alignment_idx + spot_idx;
         const size_t total = alignment_count + spot_count;
@@ -214,12 +325,14 @@ public:
     bool read(Fragment* output) override {
         switch (state) {
         case READING_ALIGNMNETS:
-            if (alit.nextAlignment()) {
+            if (alignments_in_range && alit.nextAlignment()) {
                 copy(alit, output);
                 ++alignment_idx;
                 return true;
             } else {
-                if (pit.nextRead()) {
+                if (!reads_in_range) {
+                    state = READING_EOF;
+                } else if (pit.nextRead()) {
                     state = READING_PARTIAL_READS;
                 } else if (uit.nextRead()) {
                     state = READING_UNALIGNED_READS;